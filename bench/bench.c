@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 199309L
+
+/* Headless benchmark: runs the devoidwm core in process against an X server
+ * (see run.sh for Xvfb) while a second connection plays the applications.
+ * Every scenario reports wall time, the X requests devoidwm sent and the
+ * synchronous round trips it made, followed by devoidwm's own per handler
+ * counters. */
+#include <X11/Xlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/client.h"
+#include "../src/devoid.h"
+#include "../src/dwindle.h"
+#include "../src/events.h"
+#include "../src/focus.h"
+#include "../src/ipc.h"
+#include "../src/mouse.h"
+#include "../src/stats.h"
+#include "../src/tags.h"
+
+static Display *app;
+static Window *wins;
+static unsigned int nwins;
+
+typedef struct {
+    const char *name;
+    struct timespec start;
+    unsigned long requests, roundtrips;
+} Scenario;
+
+/* lets devoidwm handle everything the applications caused so far, without
+ * counting our own syncs */
+static void pump() {
+    XEvent ev;
+
+    XSync(app, False);
+    XSync(dpy, False);
+    while (XPending(dpy)) {
+        XNextEvent(dpy, &ev);
+        handle_event(&ev);
+    }
+    flush_pending();
+    XSync(dpy, False);
+}
+
+static void begin(Scenario *s, const char *name) {
+    pump();
+    s -> name = name;
+    s -> requests = NextRequest(dpy);
+    s -> roundtrips = roundtrips;
+    clock_gettime(CLOCK_MONOTONIC, &s -> start);
+}
+
+/* the two syncs of every pump() are not devoidwm's */
+static void end(Scenario *s, unsigned int pumps) {
+    struct timespec now;
+
+    pump();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double ms = (now.tv_sec - s -> start.tv_sec) * 1e3 +
+                (now.tv_nsec - s -> start.tv_nsec) / 1e6;
+    printf("%-16s %10.2f %10lu %10lu\n", s -> name, ms,
+           NextRequest(dpy) - s -> requests - 2 * (pumps + 1),
+           roundtrips - s -> roundtrips);
+}
+
+static void map_windows() {
+    Scenario s;
+    begin(&s, "map");
+    for (unsigned int i = 0; i < nwins; i ++) {
+        wins[i] = XCreateSimpleWindow(app, DefaultRootWindow(app), 0, 0, 200, 200, 0, 0, 0);
+        XMapWindow(app, wins[i]);
+    }
+    end(&s, 0);
+}
+
+static void spread_tags() {
+    Scenario s;
+    unsigned int i = 0;
+    begin(&s, "tag");
+    for (Client *c = head; c; c = c -> next, i ++) {
+        sel = c;
+        tag((Arg){.ui = 1 << (i % TAGS)});
+    }
+    end(&s, 0);
+}
+
+static void view_tags(unsigned int rounds) {
+    Scenario s;
+    begin(&s, "view");
+    for (unsigned int r = 0; r < rounds; r ++)
+        for (unsigned int t = 0; t < TAGS; t ++) {
+            view((Arg){.ui = 1 << t});
+            pump();
+        }
+    end(&s, rounds * TAGS);
+}
+
+static void focus_cycle(unsigned int n) {
+    Scenario s;
+    view((Arg){.ui = TAGMASK});
+    begin(&s, "focus");
+    for (unsigned int i = 0; i < n; i ++) {
+        focus_adjacent((Arg){.i = 1});
+        pump();
+    }
+    end(&s, n);
+}
+
+static void drag_resize(unsigned int steps) {
+    Scenario s;
+    XEvent ev = {0};
+
+    if (!sel) return;
+    begin(&s, "drag");
+    ROUNDTRIP(XGetWindowAttributes(dpy, sel -> win, &attr));
+    prev_pointer_position = (XButtonEvent){.button = 3, .x_root = 100, .y_root = 100};
+    for (unsigned int i = 0; i < steps; i ++) {
+        ev.type = MotionNotify;
+        ev.xbutton.window = sel -> win;
+        ev.xbutton.x_root = 100 + i;
+        ev.xbutton.y_root = 100 + i;
+        handle_motionnotify(&ev);
+        pump();
+    }
+    end(&s, steps);
+}
+
+static void destroy_windows() {
+    Scenario s;
+    begin(&s, "destroy");
+    for (unsigned int i = 0; i < nwins; i ++) XDestroyWindow(app, wins[i]);
+    end(&s, 0);
+}
+
+int main(int argc, char *argv[]) {
+    nwins = argc > 1 ? atoi(argv[1]) : 200;
+    if (!nwins || !(wins = calloc(nwins, sizeof(Window)))) die("bad window count");
+
+    start();
+    grab();
+    if (!(app = XOpenDisplay(NULL))) die("failed to open display");
+
+    printf("%u windows\n%-16s %10s %10s %10s\n", nwins, "scenario", "ms", "requests",
+           "roundtrips");
+    map_windows();
+    spread_tags();
+    view_tags(10);
+    focus_cycle(nwins);
+    drag_resize(100);
+    destroy_windows();
+
+    printf("\n");
+    dumpstats(stdout);
+
+    XCloseDisplay(app);
+    cleanup_ipc();
+    return 0;
+}
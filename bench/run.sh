@@ -0,0 +1,18 @@
+#!/bin/sh
+# runs devoid-bench against a private Xvfb, arguments are passed along
+display=":${BENCH_DISPLAY:-99}"
+
+Xvfb "$display" -screen 0 1920x1080x24 -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+trap 'kill $xvfb 2>/dev/null' EXIT INT TERM
+
+# wait for the server to accept connections
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S "/tmp/.X11-unix/X${display#:}" ] && break
+    sleep 0.2
+done
+
+# keep a user's devoidrc out of the numbers and its socket away from the
+# running wm's
+DISPLAY="$display" XDG_CONFIG_HOME=/nonexistent \
+    DEVOID_SOCKET="${TMPDIR:-/tmp}/devoid-bench-$$.sock" ./devoid-bench "$@"
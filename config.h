@@ -10,6 +10,7 @@
 #include "src/focus.h"
 #include "src/rules.h"
 #include "src/dwindle.h"
+#include "src/restart.h"
 
 /* size of the master window. Range -> [0.05, 0.95] */
 extern float mratio;
@@ -59,6 +60,9 @@ static const Key keys[] = {
     /* quit devoidwm */
     {MODKEY|ShiftMask, XK_q, quit, {0}},
 
+    /* restart devoidwm in place, keeping every window */
+    {MODKEY|ShiftMask, XK_r, restart, {0}},
+
     /* focus the next/prev window */
     {MODKEY, XK_j, focus_adjacent, {.i = 1}},
     {MODKEY, XK_k, focus_adjacent, {.i = -1}},
@@ -0,0 +1,248 @@
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#include "adopt.h"
+#include "client.h"
+#include "devoid.h"
+#include "dwindle.h"
+#include "ewmh.h"
+#include "focus.h"
+#include "ipc.h"
+#include "restart.h"
+#include "rules.h"
+#include "stats.h"
+#include "../config.h"
+
+/* Takes over the windows already mapped when devoidwm starts, after a
+ * restart or when replacing another wm. Xlib can only wait for one reply
+ * at a time, so the per window queries go over a short lived xcb
+ * connection instead: every request for every window is sent first and
+ * the replies are collected afterwards, one round trip for the lot. */
+
+enum { PropDesktop, PropType, PropState, PropProtocols, PropClass, PropLast };
+
+typedef struct {
+    xcb_get_window_attributes_cookie_t attr;
+    xcb_get_geometry_cookie_t geom;
+    xcb_get_property_cookie_t props[PropLast];
+} Query;
+
+typedef struct {
+    xcb_get_property_reply_t *props[PropLast];
+} Props;
+
+/* type and length (in 32 bit units) asked for each property */
+static const Atom proptypes[PropLast] = {
+    [PropDesktop] = XA_CARDINAL,
+    [PropType] = XA_ATOM,
+    [PropState] = XA_ATOM,
+    [PropProtocols] = XA_ATOM,
+    [PropClass] = XA_STRING,
+};
+static const unsigned int proplens[PropLast] = {
+    [PropDesktop] = 1,
+    [PropType] = 1,
+    [PropState] = 1,
+    [PropProtocols] = 32,
+    [PropClass] = 64,
+};
+
+/* the first 32 bit item of a property, def if it is missing */
+static unsigned long first32(xcb_get_property_reply_t *r, unsigned long def) {
+    if (!r || r -> format != 32 || r -> value_len < 1) return def;
+    return *(uint32_t *)xcb_get_property_value(r);
+}
+
+static void manage(Window win, xcb_get_geometry_reply_t *g, Props *p) {
+    Client *c = newclient(win);
+    unsigned long desktop = first32(p -> props[PropDesktop], TAGS);
+    xcb_get_property_reply_t *r;
+    bool known;
+
+    /* the tag it was on before, the selected one if it had none */
+    if (desktop == 0xFFFFFFFF) c -> tags = TAGMASK;
+    else if (desktop < TAGS) c -> tags = 1 << desktop;
+    if (desktop == 0xFFFFFFFF || desktop < TAGS) c -> desktop = desktop;
+
+    /* windows parked off screen by a previous instance come back at the
+     * origin of the usable area */
+    c -> geom = (Geometry){g -> x, g -> y, g -> width, g -> height};
+    if (g -> x >= DW || g -> y >= DH) {
+        c -> geom.x = root.x;
+        c -> geom.y = root.y;
+        c -> ishidden = 1;
+    }
+    c -> bw = g -> border_width;
+    c -> bpx = normbpx;
+
+    /* after a restart the snapshot knows better than the rules */
+    known = restoreclient(c);
+
+    XSelectInput(dpy, win, StructureNotifyMask|EnterWindowMask|PropertyChangeMask);
+    XSetWindowBorder(dpy, win, normbpx);
+    attach(c);
+
+    if ((r = p -> props[PropProtocols]) && r -> format == 32) {
+        uint32_t *atoms = xcb_get_property_value(r);
+        for (unsigned int i = 0; i < r -> value_len; i ++) c -> protocols |= protomask(atoms[i]);
+    }
+    if (!known) set_window_state(c, first32(p -> props[PropType], None), None);
+    if (!known && !c -> isfloating)
+        set_window_state(c, None, first32(p -> props[PropState], None));
+
+    /* WM_CLASS is "instance\0class\0" */
+    if (!known && (r = p -> props[PropClass]) && r -> format == 8) {
+        int len = xcb_get_property_value_length(r);
+        char *s = xcb_get_property_value(r), *buf;
+        if (!(buf = (char *)malloc(len + 1))) die("memory allocation failed");
+        memcpy(buf, s, len);
+        buf[len] = '\0';
+        size_t n = strlen(buf);
+        match_rules(c, (int)n + 1 < len ? buf + n + 1 : NULL, buf);
+        free(buf);
+    }
+
+    setborder(c, border_width, normbpx);
+
+    if (c -> isfloating) {
+        c -> x = c -> geom.x;
+        c -> y = c -> geom.y;
+        c -> width = c -> geom.w;
+        c -> height = c -> geom.h;
+    } else if (c -> isfullscr && isvisible(c, 0)) lock_fullscr(c);
+
+    /* focus() skips clients off the selected tags, they still belong on
+     * the stack */
+    attachstack(c);
+    focus(c);
+    notify_window(c -> win, 1);
+}
+
+/* position of every child in the old client list, for adoptorder() */
+static int *ranks;
+
+/* windows from the snapshot first, in their old order, the unknown ones
+ * after them in stacking order */
+static int byrank(const void *a, const void *b) {
+    unsigned int i = *(const unsigned int *)a, j = *(const unsigned int *)b;
+    int ri = ranks[i] < 0 ? INT_MAX : ranks[i], rj = ranks[j] < 0 ? INT_MAX : ranks[j];
+
+    if (ri != rj) return ri < rj ? -1 : 1;
+    return i < j ? -1 : i > j;
+}
+
+static unsigned int* adoptorder(Window *children, unsigned int n) {
+    unsigned int *order;
+
+    if (!(order = (unsigned int *)malloc(n * sizeof(unsigned int))) ||
+        !(ranks = (int *)malloc(n * sizeof(int))))
+        die("memory allocation failed");
+    for (unsigned int i = 0; i < n; i ++) {
+        order[i] = i;
+        ranks[i] = snapshotrank(children[i]);
+    }
+    qsort(order, n, sizeof(unsigned int), byrank);
+
+    free(ranks);
+    ranks = NULL;
+    return order;
+}
+
+void adopt() {
+    Window root_return, parent_return, *children;
+    unsigned int n, i, j, *order;
+    xcb_connection_t *xc;
+    Query *q;
+    Atom props[PropLast] = {
+        [PropDesktop] = net_atoms[NetWMDesktop],
+        [PropType] = net_atoms[NetWMWindowType],
+        [PropState] = net_atoms[NetWMState],
+        [PropProtocols] = wm_atoms[WMProtocols],
+        [PropClass] = XA_WM_CLASS,
+    };
+
+    if (!ROUNDTRIP(XQueryTree(dpy, root.win, &root_return, &parent_return, &children, &n)))
+        return;
+    if (!n) {
+        if (children) XFree(children);
+        XDeleteProperty(dpy, root.win, snapshot_atom);
+        return;
+    }
+
+    xc = xcb_connect(DisplayString(dpy), NULL);
+    if (xcb_connection_has_error(xc)) {
+        fprintf(stderr, "devoidwm: failed to connect with xcb, existing windows left alone\n");
+        xcb_disconnect(xc);
+        XFree(children);
+        return;
+    }
+    if (!(q = (Query *)malloc((n + 1) * sizeof(Query)))) die("memory allocation failed");
+
+    /* q[n] is the root: the tag that was selected and the snapshot left by
+     * a restart, deleted as it is read. The server only deletes it when
+     * all of it was read, and windows may have closed since it was saved,
+     * so ask for everything rather than what n windows would take */
+    q[n].props[0] = xcb_get_property(xc, 0, root.win, net_atoms[NetCurrentDesktop],
+                                     XA_CARDINAL, 0, 1);
+    q[n].props[1] = xcb_get_property(xc, 1, root.win, snapshot_atom, XA_CARDINAL, 0,
+                                     UINT32_MAX);
+    for (i = 0; i < n; i ++) {
+        q[i].attr = xcb_get_window_attributes(xc, children[i]);
+        q[i].geom = xcb_get_geometry(xc, children[i]);
+        for (j = 0; j < PropLast; j ++)
+            q[i].props[j] = xcb_get_property(xc, 0, children[i], props[j],
+                                             proptypes[j], 0, proplens[j]);
+    }
+    xcb_flush(xc);
+    roundtrips ++;
+
+    xcb_get_property_reply_t *cur = xcb_get_property_reply(xc, q[n].props[0], NULL);
+    unsigned long desktop = first32(cur, TAGS);
+    if (desktop < TAGS && (1u << desktop) != seltags) {
+        unsigned int prevtags = seltags;
+        seltags = 1 << desktop;
+        switchlayout(prevtags);
+    }
+    free(cur);
+
+    xcb_get_property_reply_t *snap = xcb_get_property_reply(xc, q[n].props[1], NULL);
+    if (snap && snap -> format == 32)
+        loadsnapshot(xcb_get_property_value(snap), snap -> value_len);
+    free(snap);
+
+    /* children come bottom to top, so without a snapshot the topmost ends
+     * up focused. xcb hands out the replies in whatever order asked */
+    order = adoptorder(children, n);
+    for (unsigned int k = 0; k < n; k ++) {
+        i = order[k];
+        xcb_get_window_attributes_reply_t *a = xcb_get_window_attributes_reply(xc, q[i].attr, NULL);
+        xcb_get_geometry_reply_t *g = xcb_get_geometry_reply(xc, q[i].geom, NULL);
+        Props p;
+        for (j = 0; j < PropLast; j ++)
+            p.props[j] = xcb_get_property_reply(xc, q[i].props[j], NULL);
+
+        if (a && g && !a -> override_redirect && a -> map_state == XCB_MAP_STATE_VIEWABLE &&
+            !wintoclient(children[i]))
+            manage(children[i], g, &p);
+
+        free(a);
+        free(g);
+        for (j = 0; j < PropLast; j ++) free(p.props[j]);
+    }
+    restorestack();
+
+    free(order);
+    free(q);
+    XFree(children);
+    xcb_disconnect(xc);
+
+    /* one pass for everything: windows off the selected tags are parked,
+     * the rest is laid out by the first flush_pending() */
+    showhide(TAGMASK);
+    dirty |= DirtyLayout | DirtyClients;
+}
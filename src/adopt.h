@@ -0,0 +1,6 @@
+#ifndef ADOPT_H
+#define ADOPT_H
+
+void adopt();
+
+#endif
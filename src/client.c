@@ -7,38 +7,157 @@
 #include "dwindle.h"
 #include "events.h"
 #include "ewmh.h"
+#include "ipc.h"
 #include "tags.h"
+#include "stats.h"
 #include "../config.h"
 
-void attach(Client *c) {
-    if (!head) {
-        head = c;
-        return;
+#define SWAP(type, a, b) do { type tmp = (a); (a) = (b); (b) = tmp; } while (0)
+
+/* window -> client lookup, open addressing with linear probing.
+ * Kept in sync by attach() and detach(). */
+static Client **wintable;
+static unsigned int wintable_size, wintable_count;
+
+static unsigned int winhash(Window win) {
+    win ^= win >> 16;
+    return (unsigned int)(win * 0x45d9f3bUL) & (wintable_size - 1);
+}
+
+/* a window already in the table keeps its entry, returns 0 */
+static bool wintable_put(Client *c) {
+    unsigned int i = winhash(c -> win);
+    while (wintable[i]) {
+        if (wintable[i] -> win == c -> win) return 0;
+        i = (i + 1) & (wintable_size - 1);
     }
+    wintable[i] = c;
+    return 1;
+}
+
+static void wintable_grow() {
+    Client **old = wintable;
+    unsigned int oldsize = wintable_size;
+
+    wintable_size = oldsize ? oldsize * 2 : 64;
+    if (!(wintable = (Client **)calloc(wintable_size, sizeof(Client *))))
+        die("memory allocation failed");
 
-    Client *i = head;
-    while (i -> next != NULL) i = i -> next;
-    i -> next = c;
+    for (unsigned int i = 0; i < oldsize; i ++)
+        if (old[i]) wintable_put(old[i]);
+    free(old);
 }
 
-void detach(Client *c) {
-    if (head == c) {
-        head = head -> next;
-        return;
+static void wintable_insert(Client *c) {
+    /* keep the load factor under 1/2 */
+    if ((wintable_count + 1) * 2 > wintable_size) wintable_grow();
+    if (wintable_put(c)) wintable_count ++;
+}
+
+static void wintable_remove(Window win) {
+    if (!wintable_count) return;
+
+    unsigned int mask = wintable_size - 1, i = winhash(win), j;
+    while (wintable[i] && wintable[i] -> win != win) i = (i + 1) & mask;
+    if (!wintable[i]) return;
+
+    /* backward shift deletion, so lookups never need tombstones */
+    for (j = (i + 1) & mask; wintable[j]; j = (j + 1) & mask) {
+        unsigned int k = winhash(wintable[j] -> win);
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+            wintable[i] = wintable[j];
+            i = j;
+        }
+    }
+    wintable[i] = NULL;
+    wintable_count --;
+}
+
+/* the clients on each tag, so walking the selected tag skips the others */
+static Client *taghead[TAGS], *tagtail[TAGS];
+static Client *tail;
+static unsigned long lastseq;
+
+/* the index of the tag when tags selects exactly one, -1 otherwise */
+int tagindex(unsigned int tags) {
+    if (!tags || (tags & (tags - 1))) return -1;
+
+    int t = 0;
+    while (!(tags & 1)) {
+        tags >>= 1;
+        t ++;
     }
+    return t < TAGS ? t : -1;
+}
+
+static void taglink(Client *c, int t) {
+    /* keep the list in client list order, appends stop right away */
+    Client *p = tagtail[t];
+    while (p && p -> seq > c -> seq) p = p -> tprev[t];
+
+    c -> tprev[t] = p;
+    c -> tnext[t] = p ? p -> tnext[t] : taghead[t];
+    if (c -> tnext[t]) c -> tnext[t] -> tprev[t] = c;
+    else tagtail[t] = c;
+    if (p) p -> tnext[t] = c;
+    else taghead[t] = c;
+}
+
+static void tagunlink(Client *c, int t) {
+    if (c -> tprev[t]) c -> tprev[t] -> tnext[t] = c -> tnext[t];
+    else taghead[t] = c -> tnext[t];
+    if (c -> tnext[t]) c -> tnext[t] -> tprev[t] = c -> tprev[t];
+    else tagtail[t] = c -> tprev[t];
+    c -> tnext[t] = c -> tprev[t] = NULL;
+}
+
+void attach(Client *c) {
+    wintable_insert(c);
+    dirty |= DirtyClients;
+
+    c -> seq = ++ lastseq;
+    for (int t = 0; t < TAGS; t ++)
+        if (c -> tags & 1 << t) taglink(c, t);
+
+    c -> next = NULL;
+    c -> prev = tail;
+    if (tail) tail -> next = c;
+    else head = c;
+    tail = c;
+}
+
+void detach(Client *c) {
+    wintable_remove(c -> win);
+    dirty |= DirtyClients;
+
+    for (int t = 0; t < TAGS; t ++)
+        if (c -> tags & 1 << t) tagunlink(c, t);
 
-    Client *i = head;
-    while (i -> next != c) {
-        i = i -> next;
-        if (!i) return;
+    if (c -> prev) c -> prev -> next = c -> next;
+    else head = c -> next;
+    if (c -> next) c -> next -> prev = c -> prev;
+    else tail = c -> prev;
+    c -> next = c -> prev = NULL;
+}
+
+void settags(Client *c, unsigned int tags) {
+    tags &= TAGMASK;
+    for (int t = 0; t < TAGS; t ++) {
+        if ((c -> tags & 1 << t) && !(tags & 1 << t)) tagunlink(c, t);
+        else if (!(c -> tags & 1 << t) && (tags & 1 << t)) taglink(c, t);
     }
-    i -> next = c -> next;
+    c -> tags = tags;
+    dirty |= DirtyClients;
 }
 
 Client* wintoclient(Window win) {
-    Client *i;
-    for (i = head; i; i = i -> next)
-        if (i -> win == win) return i;
+    if (!wintable_count) return NULL;
+
+    unsigned int i = winhash(win);
+    while (wintable[i]) {
+        if (wintable[i] -> win == win) return wintable[i];
+        i = (i + 1) & (wintable_size - 1);
+    }
     return NULL;
 }
 
@@ -50,99 +169,167 @@ void togglefullscr(Arg arg) {
     else lock_fullscr(sel);
 }
 
-Client* nexttiled(Client *next, unsigned int tags) {
-    if (!head || !next) return NULL;
+/* The iterators below return the client after (or before) c, starting
+ * from the beginning (or the end) when c is NULL. With a single tag
+ * selected they follow that tag's list instead of the whole client list. */
+static Client* following(Client *c, int t) {
+    if (t < 0) return c ? c -> next : head;
+    return c ? c -> tnext[t] : taghead[t];
+}
 
-    while (next -> isfloating || !isvisible(next, tags)) {
-        next = next -> next;
-        if (!next) return NULL;
-    }
-    return next;
+static Client* preceding(Client *c, int t) {
+    if (t < 0) return c ? c -> prev : tail;
+    return c ? c -> tprev[t] : tagtail[t];
 }
 
-Client* prevtiled(Client *c, unsigned int tags) {
-    if (!head || !c) return NULL;
+static int iterindex(Client *c, unsigned int tags) {
+    int t = tagindex(tags);
+    return c && t >= 0 && !(c -> tags & tags) ? -1 : t;
+}
 
-    Client *i = head, *prev = NULL;
-    do {
-        if (!i -> isfloating && isvisible(i, tags)) prev = i;
-        i = i -> next;
-    } while (i && i != c);
+Client* nexttiled(Client *c, unsigned int tags) {
+    if (!tags) tags = seltags;
+    int t = iterindex(c, tags);
 
-    return prev;
+    do c = following(c, t);
+    while (c && (c -> isfloating || !isvisible(c, tags)));
+    return c;
 }
 
-Client* nextvisible(Client *next, unsigned int tags) {
-    if (!head || !next) return NULL;
+Client* nextvisible(Client *c, unsigned int tags) {
+    if (!tags) tags = seltags;
+    int t = iterindex(c, tags);
 
-    while (!isvisible(next, tags)) {
-        next = next -> next;
-        if (!next) return NULL;
-    }
-    return next;
+    do c = following(c, t);
+    while (c && !isvisible(c, tags));
+    return c;
 }
 
-Client* prevvisible(Client *c, unsigned int tags) {
-    if (!head || !c) return NULL;
-
-    Client *i = head, *prev = NULL;
-    do {
-        if (isvisible(i, tags)) prev = i;
-        i = i -> next;
-    } while (i && i != c);
+Client* prevtiled(Client *c, unsigned int tags) {
+    if (!tags) tags = seltags;
+    int t = iterindex(c, tags);
 
-    return prev;
+    do c = preceding(c, t);
+    while (c && (c -> isfloating || !isvisible(c, tags)));
+    return c;
 }
 
-Client* get_visible_head() {
-    if (!head) return NULL;
+Client* prevvisible(Client *c, unsigned int tags) {
+    if (!tags) tags = seltags;
+    int t = iterindex(c, tags);
 
-    Client *i = head;
-    while (i && !isvisible(i, 0)) i = i -> next;
+    do c = preceding(c, t);
+    while (c && !isvisible(c, tags));
+    return c;
+}
 
-    return i;
+Client* get_visible_head() {
+    return nextvisible(NULL, 0);
 }
 
 Client* get_visible_tail() {
-    if (!head) return NULL;
+    return prevvisible(NULL, 0);
+}
 
-    Client *i = head, *prev;
-    while (i) {
-        if (isvisible(i, 0)) prev = i;
-        i = i -> next;
+/* Clients are carved out of fixed size slabs and recycled through a free
+ * list, slabs are never given back */
+#define SLABSIZE 64
+
+typedef struct Slab Slab;
+struct Slab {
+    Slab *next;
+    Client clients[SLABSIZE];
+};
+
+static Slab *slabs;
+static Client *freeclients;
+static unsigned int pool_used, pool_capacity, pool_peak;
+
+static Client* allocclient() {
+    if (!freeclients) {
+        Slab *slab;
+        if (!(slab = (Slab *)malloc(sizeof(Slab))))
+            die("memory allocation failed");
+        slab -> next = slabs;
+        slabs = slab;
+
+        /* hand them out in address order */
+        for (int i = SLABSIZE - 1; i >= 0; i --) {
+            slab -> clients[i].next = freeclients;
+            freeclients = &slab -> clients[i];
+        }
+        pool_capacity += SLABSIZE;
     }
 
-    return prev;
+    Client *c = freeclients;
+    freeclients = c -> next;
+    if (++ pool_used > pool_peak) pool_peak = pool_used;
+    return c;
+}
+
+void freeclient(Client *c) {
+    c -> next = freeclients;
+    freeclients = c;
+    pool_used --;
+}
+
+void poolstats(unsigned int *used, unsigned int *capacity, unsigned int *peak) {
+    *used = pool_used;
+    *capacity = pool_capacity;
+    *peak = pool_peak;
 }
 
 Client *newclient(Window win) {
-    Client *c;
-    if (!(c = (Client *)malloc(sizeof(Client))))
-        die("memory allocation failed");
+    Client *c = allocclient();
 
     c -> win = win;
-    c -> tags = seltags;
-    c -> next = c -> snext = NULL;
+    c -> tags = seltags & TAGMASK;
+    /* an impossible size, so the first configure is always sent */
+    c -> geom = (Geometry){0, 0, 0, 0};
+    c -> serial = 0;
+    c -> protocols = 0;
+    c -> desktop = -1;
+    c -> ishidden = 0;
+    c -> next = c -> prev = c -> snext = c -> sprev = NULL;
+    for (int t = 0; t < TAGS; t ++) c -> tnext[t] = c -> tprev[t] = NULL;
     return c;
 }
 
-void showhide(Client *c) {
-    if (!c) return;
-
-    if (isvisible(c, 0)) {
-        XMoveWindow(dpy, c -> win, c -> x, c -> y);
-        showhide(c -> next);
-    } else {
-        showhide(c -> next);
-        XGetWindowAttributes(dpy, c -> win, &attr);
-        if (attr.x == DW) return;
-        c -> x = attr.x;
-        c -> y = attr.y;
-        c -> width = attr.width;
-        c -> height = attr.height;
-        XMoveWindow(dpy, c -> win, DW,
-                    DH);
+/* clients changing visibility on a tag switch */
+static Client **showset, **hideset;
+static unsigned int setsize;
+
+/* moves every client on tags on or off the screen, clients on none of
+ * them keep their state. All the windows coming into view are moved
+ * before any leaving it, so the screen is never left blank, and nothing
+ * is flushed here: the whole switch goes out with the event batch. */
+void showhide(unsigned int tags) {
+    unsigned int nshow = 0, nhide = 0, i;
+
+    for (int t = 0; t < TAGS; t ++) {
+        if (!(tags & 1 << t)) continue;
+
+        for (Client *c = taghead[t]; c; c = c -> tnext[t]) {
+            /* clients on several of the tags are handled by the lowest one */
+            unsigned int shared = c -> tags & tags;
+            if ((shared & (~shared + 1)) != 1u << t) continue;
+
+            bool visible = isvisible(c, 0);
+            if (visible != c -> ishidden) continue;
+
+            if (nshow == setsize || nhide == setsize) {
+                setsize = setsize ? setsize * 2 : 32;
+                if (!(showset = (Client **)realloc(showset, setsize * sizeof(Client *))) ||
+                    !(hideset = (Client **)realloc(hideset, setsize * sizeof(Client *))))
+                    die("memory allocation failed");
+            }
+            if (visible) showset[nshow ++] = c;
+            else hideset[nhide ++] = c;
+        }
     }
+
+    for (i = 0; i < nshow; i ++) showclient(showset[i]);
+    for (i = 0; i < nhide; i ++) hideclient(hideset[i]);
 }
 
 void killclient(Arg arg) {
@@ -150,22 +337,38 @@ void killclient(Arg arg) {
     if (!sel) return;
 
     /* send kill signal to window */
-    if (!sendevent(sel -> win, XInternAtom(dpy, "WM_DELETE_WINDOW", True))) {
+    if (!sendevent(sel -> win, wm_atoms[WMDelete])) {
         /* If the client rejects it, we close it down the brutal way */
         XGrabServer(dpy);
         XSetCloseDownMode(dpy, DestroyAll);
         XKillClient(dpy, sel -> win);
-        XSync(dpy, False);
+        ROUNDTRIP(XSync(dpy, False));
         XUngrabServer(dpy);
     }
 }
 
 void swap(Client *focused_client, Client *target_client) {
     if (focused_client == NULL || target_client == NULL) return;
-
-    Window temp = focused_client -> win;
-    focused_client -> win = target_client -> win;
-    target_client -> win = temp;
+    if (focused_client == target_client) return;
+
+    /* the windows trade clients, so their lookup entries must follow */
+    wintable_remove(focused_client -> win);
+    wintable_remove(target_client -> win);
+
+    /* the window and everything known about it trade places, the
+     * position in the layout stays with the client */
+    SWAP(Window, focused_client -> win, target_client -> win);
+    SWAP(Geometry, focused_client -> geom, target_client -> geom);
+    SWAP(unsigned long, focused_client -> serial, target_client -> serial);
+    SWAP(bool, focused_client -> ishidden, target_client -> ishidden);
+    SWAP(unsigned int, focused_client -> protocols, target_client -> protocols);
+    SWAP(unsigned int, focused_client -> bw, target_client -> bw);
+    SWAP(unsigned long, focused_client -> bpx, target_client -> bpx);
+    SWAP(long, focused_client -> desktop, target_client -> desktop);
+
+    wintable_insert(focused_client);
+    wintable_insert(target_client);
+    dirty |= DirtyClients;
 
     resize(focused_client);
     resize(target_client);
@@ -179,23 +382,67 @@ void zoom(Arg arg) {
 
     swap(sel, visible_head);
     focus(visible_head);
-    XSync(dpy, True);
 }
 
 void resize(Client *c) {
     if (c -> isfloating)
-        XMoveResizeWindow(dpy, c -> win, c -> x, c -> y, c -> width, c -> height);
+        moveresize(c, c -> x, c -> y, c -> width, c -> height);
     else
-        XMoveResizeWindow(dpy, c -> win, c -> x + gap, c -> y + gap,
-                          c -> width - (gap * 2 + border_width),
-                          c -> height - (gap * 2 + border_width));
+        moveresize(c, c -> x + gap, c -> y + gap,
+                   c -> width - (gap * 2 + border_width),
+                   c -> height - (gap * 2 + border_width));
+}
+
+/* configures the window only if it differs from what was last applied */
+void moveresize(Client *c, int x, int y, unsigned int w, unsigned int h) {
+    if (!c -> ishidden && c -> geom.x == x && c -> geom.y == y &&
+        c -> geom.w == w && c -> geom.h == h)
+        return;
+
+    dirty |= DirtyCrossing;
+    c -> serial = NextRequest(dpy);
+    if (c -> geom.w == w && c -> geom.h == h) XMoveWindow(dpy, c -> win, x, y);
+    else XMoveResizeWindow(dpy, c -> win, x, y, w, h);
+    c -> geom = (Geometry){x, y, w, h};
+    c -> ishidden = 0;
+}
+
+void setborder(Client *c, unsigned int width, unsigned long px) {
+    if (c -> bw != width) {
+        XSetWindowBorderWidth(dpy, c -> win, width);
+        c -> bw = width;
+    }
+    if (c -> bpx != px) {
+        XSetWindowBorder(dpy, c -> win, px);
+        c -> bpx = px;
+    }
+}
+
+/* hidden windows are parked off screen, geom keeps where they came from so
+ * they can be brought back without asking the server */
+void showclient(Client *c) {
+    if (!c -> ishidden) return;
+    dirty |= DirtyCrossing;
+    c -> serial = NextRequest(dpy);
+    XMoveWindow(dpy, c -> win, c -> geom.x, c -> geom.y);
+    c -> ishidden = 0;
+}
+
+void hideclient(Client *c) {
+    if (c -> ishidden) return;
+    dirty |= DirtyCrossing;
+    c -> serial = NextRequest(dpy);
+    XMoveWindow(dpy, c -> win, DW, DH);
+    c -> ishidden = 1;
 }
 
 void incmaster(Arg arg) {
-    unsigned int n = MAX(arg.i + nmaster, 1);
+    /* signed, a large decrement must not wrap around */
+    long n = (long)nmaster + arg.i;
+    n = MIN(MAXNMASTER, MAX(n, 1));
     if (n == nmaster) return;
     nmaster = n;
-    tile();
+    dirty |= DirtyLayout;
 }
 
 unsigned int isvisible(Client *c, unsigned int tags) {
@@ -207,29 +454,30 @@ void setmratio(Arg arg) {
     float new_mratio = MIN(0.95, MAX(0.05, mratio + arg.f));
     if (new_mratio == mratio) return;
     mratio = new_mratio;
-    tile();
+    dirty |= DirtyLayout;
 }
 
 void lock_fullscr(Client *c) {
-    XMoveResizeWindow(dpy, c -> win, 0, 0, DW, DH);
+    if (!c -> isfullscr) notify_fullscreen(c -> win, 1);
+    moveresize(c, 0, 0, DW, DH);
     c -> isfullscr = 1;
-    XSetWindowBorderWidth(dpy, c -> win, 0);
-    XRaiseWindow(dpy, c -> win);
+    setborder(c, 0, c -> bpx);
+    raisewindow(c -> win);
 }
 
 void unlock_fullscr(Client *c) {
     if (isvisible(c, 0)) {
-        XSetWindowBorderWidth(dpy, c -> win, border_width);
-        tile();
+        setborder(c, border_width, c -> bpx);
+        dirty |= DirtyLayout;
     }
+    if (c -> isfullscr) notify_fullscreen(c -> win, 0);
     c -> isfullscr = 0;
-    XSync(dpy, true);
 }
 
 unsigned int getcolor(const char *color) {
     XColor c;
     Colormap colormap = DefaultColormap(dpy, screen);
-    if (!XAllocNamedColor(dpy, colormap, color, &c, &c))
+    if (!ROUNDTRIP(XAllocNamedColor(dpy, colormap, color, &c, &c)))
         die("invalid color");
 
     return c.pixel;
@@ -6,14 +6,31 @@
 
 #include "key.h"
 
+/* number of tags */
+#define TAGS 9
+#define TAGMASK ((1 << TAGS) - 1)
+
+typedef struct {
+    int x, y;
+    unsigned int w, h;
+} Geometry;
+
 typedef struct Client Client;
 struct Client {
     Window win;
     int x, y;
     unsigned int width, height;
-    Client *next, *snext;
-    bool isfloating, isfullscr;
+    Geometry geom; /* last on screen geometry of the window */
+    unsigned long serial; /* request that last configured the window */
+    unsigned int bw; /* border width and color last applied */
+    unsigned long bpx;
+    Client *next, *prev, *snext, *sprev;
+    Client *tnext[TAGS], *tprev[TAGS]; /* per tag lists, in attach order */
+    unsigned long seq; /* position in the client list */
+    bool isfloating, isfullscr, ishidden;
     unsigned int tags;
+    unsigned int protocols; /* cached WM_PROTOCOLS, see ewmh.h */
+    long desktop; /* _NET_WM_DESKTOP last written, -1 before the first */
 };
 
 void attach(Client *client);
@@ -24,14 +41,22 @@ Client* prevtiled(Client *c, unsigned int tags);
 Client* nextvisible(Client *c, unsigned int tags);
 Client* prevvisible(Client *c, unsigned int tags);
 Client* newclient(Window win);
+void freeclient(Client *c);
+void poolstats(unsigned int *used, unsigned int *capacity, unsigned int *peak);
+void settags(Client *c, unsigned int tags);
+int tagindex(unsigned int tags);
 Client* get_visible_head();
 Client* get_visible_tail();
 void togglefullscr(Arg arg);
-void showhide(Client *c);
+void showhide(unsigned int tags);
 void killclient(Arg arg);
 void swap(Client *focused_client, Client *target_client);
 void zoom(Arg arg);
 void resize(Client *client);
+void moveresize(Client *c, int x, int y, unsigned int w, unsigned int h);
+void setborder(Client *c, unsigned int width, unsigned long px);
+void showclient(Client *c);
+void hideclient(Client *c);
 void incmaster(Arg arg);
 void setmratio(Arg arg);
 unsigned int isvisible(Client *c, unsigned int tags);
@@ -0,0 +1,242 @@
+#include <X11/Xlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "client.h"
+#include "conf.h"
+#include "devoid.h"
+#include "key.h"
+#include "rules.h"
+#include "stats.h"
+#include "../config.h"
+
+/* Optional config file, $XDG_CONFIG_HOME/devoid/devoidrc or
+ * ~/.config/devoid/devoidrc. One setting per line, # starts a comment:
+ *
+ *     gap 4
+ *     margin 20 0 0 0              # top right bottom left
+ *     focused_border_color #7ea89e
+ *     normal_border_color #10151a
+ *     rule class Gcolor3 float
+ *     rule instance mpv fullscreen
+ *     bind Mod4+Shift+q quit
+ *     bind Mod4+1 view 1
+ *
+ * Whatever the file sets overrides config.h, bindings and rules replacing
+ * keys[] and rules[] as a whole. It is read at startup and again on SIGHUP
+ * or the reload action, a file with errors leaves the running config
+ * untouched. */
+
+/* the tables installed by the last successful read */
+static Key *loadedkeys;
+static Rule *loadedrules;
+
+typedef struct {
+    Key *keys;
+    Rule *rules;
+    size_t nkeys, nrules, keyssize, rulessize;
+    long gap, margins[4];
+    bool hasgap, hasmargins, hasselbpx, hasnormbpx;
+    unsigned long selbpx, normbpx;
+} Config;
+
+static FILE* openconfig(char *path, size_t size) {
+    char *dir = getenv("XDG_CONFIG_HOME");
+    if (dir && *dir) snprintf(path, size, "%s/devoid/devoidrc", dir);
+    else if ((dir = getenv("HOME"))) snprintf(path, size, "%s/.config/devoid/devoidrc", dir);
+    else return NULL;
+    return fopen(path, "r");
+}
+
+static char* copystr(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *copy = (char *)malloc(n);
+    if (!copy) die("memory allocation failed");
+    return memcpy(copy, s, n);
+}
+
+static void* grow(void *array, size_t *size, size_t n, size_t elemsize) {
+    if (n < *size) return array;
+    *size = *size ? *size * 2 : 16;
+    if (!(array = realloc(array, *size * elemsize))) die("memory allocation failed");
+    return array;
+}
+
+static void freeconfig(Config *cfg) {
+    for (size_t i = 0; i < cfg -> nrules; i ++) {
+        free(cfg -> rules[i].classname);
+        free(cfg -> rules[i].instance);
+    }
+    free(cfg -> rules);
+    free(cfg -> keys);
+}
+
+static bool parsecolor(const char *name, unsigned long *px) {
+    XColor c;
+    if (!name ||
+        !ROUNDTRIP(XAllocNamedColor(dpy, DefaultColormap(dpy, screen), name, &c, &c)))
+        return 0;
+    *px = c.pixel;
+    return 1;
+}
+
+static bool parsekey(char *str, unsigned int *modifier, KeySym *keysym) {
+    static const struct { const char *name; unsigned int mask; } mods[] = {
+        {"Mod", 0}, {"Shift", ShiftMask}, {"Control", ControlMask},
+        {"Ctrl", ControlMask}, {"Mod1", Mod1Mask}, {"Alt", Mod1Mask},
+        {"Mod4", Mod4Mask}, {"Super", Mod4Mask},
+    };
+    char *plus;
+
+    *modifier = 0;
+    while ((plus = strchr(str, '+'))) {
+        size_t i;
+        *plus = '\0';
+        for (i = 0; i < sizeof(mods) / sizeof(*mods); i ++)
+            if (!strcmp(mods[i].name, str)) break;
+        if (i == sizeof(mods) / sizeof(*mods)) return 0;
+        /* Mod is whatever MODKEY is */
+        *modifier |= mods[i].mask ? mods[i].mask : MODKEY;
+        str = plus + 1;
+    }
+
+    return (*keysym = XStringToKeysym(str)) != NoSymbol;
+}
+
+static bool parseline(Config *cfg, char *line) {
+    char *cmd = strtok(line, " \t\n");
+    if (!cmd || *cmd == '#') return 1;
+
+    if (!strcmp(cmd, "gap")) {
+        char *v = strtok(NULL, " \t\n"), *end;
+        if (!v || (cfg -> gap = strtol(v, &end, 10)) < 0 || *end) return 0;
+        cfg -> hasgap = 1;
+
+    } else if (!strcmp(cmd, "margin")) {
+        for (int i = 0; i < 4; i ++) {
+            char *v = strtok(NULL, " \t\n"), *end;
+            if (!v || (cfg -> margins[i] = strtol(v, &end, 10)) < 0 || *end) return 0;
+        }
+        cfg -> hasmargins = 1;
+
+    } else if (!strcmp(cmd, "focused_border_color")) {
+        if (!parsecolor(strtok(NULL, " \t\n"), &cfg -> selbpx)) return 0;
+        cfg -> hasselbpx = 1;
+
+    } else if (!strcmp(cmd, "normal_border_color")) {
+        if (!parsecolor(strtok(NULL, " \t\n"), &cfg -> normbpx)) return 0;
+        cfg -> hasnormbpx = 1;
+
+    } else if (!strcmp(cmd, "rule")) {
+        char *by = strtok(NULL, " \t\n"), *name = strtok(NULL, " \t\n"), *flag;
+        if (!by || !name || (strcmp(by, "class") && strcmp(by, "instance"))) return 0;
+
+        Rule r = {NULL, NULL, 0, 0};
+        while ((flag = strtok(NULL, " \t\n")) && *flag != '#') {
+            if (!strcmp(flag, "float")) r.isfloating = 1;
+            else if (!strcmp(flag, "fullscreen")) r.isfullscreen = 1;
+            else return 0;
+        }
+        if (!strcmp(by, "class")) r.classname = copystr(name);
+        else r.instance = copystr(name);
+
+        cfg -> rules = grow(cfg -> rules, &cfg -> rulessize, cfg -> nrules, sizeof(Rule));
+        cfg -> rules[cfg -> nrules ++] = r;
+
+    } else if (!strcmp(cmd, "bind")) {
+        char *combo = strtok(NULL, " \t\n"), *name = strtok(NULL, " \t\n");
+        char *value = strtok(NULL, " \t\n");
+        const Action *action;
+        Key k;
+
+        if (value && *value == '#') value = NULL;
+        if (!combo || !name || !(action = getaction(name))) return 0;
+        if (!parsekey(combo, &k.modifier, &k.keysym)) return 0;
+        if (!parsearg(action, value, &k.arg)) return 0;
+        k.execute = action -> execute;
+
+        cfg -> keys = grow(cfg -> keys, &cfg -> keyssize, cfg -> nkeys, sizeof(Key));
+        cfg -> keys[cfg -> nkeys ++] = k;
+
+    } else return 0;
+
+    return 1;
+}
+
+/* reads the config file and installs it over the compiled in defaults,
+ * all or nothing. The indices built from the tables are left to the
+ * caller. */
+bool readconfig() {
+    static bool saved;
+    static unsigned int defgap, defmargins[4];
+    static unsigned long defselbpx, defnormbpx;
+    char path[4096], line[1024];
+    Config cfg = {0};
+    FILE *file;
+    int n = 0;
+
+    if (!saved) {
+        defgap = gap;
+        defmargins[0] = margin_top;
+        defmargins[1] = margin_right;
+        defmargins[2] = margin_bottom;
+        defmargins[3] = margin_left;
+        defselbpx = selbpx;
+        defnormbpx = normbpx;
+        saved = 1;
+    }
+
+    if ((file = openconfig(path, sizeof(path)))) {
+        while (fgets(line, sizeof(line), file)) {
+            n ++;
+            if (!parseline(&cfg, line)) {
+                fprintf(stderr, "devoidwm: %s:%d: invalid line, config not loaded\n",
+                        path, n);
+                fclose(file);
+                freeconfig(&cfg);
+                return 0;
+            }
+        }
+        fclose(file);
+    }
+
+    gap = cfg.hasgap ? cfg.gap + border_width : defgap;
+    margin_top = cfg.hasmargins ? cfg.margins[0] : defmargins[0];
+    margin_right = cfg.hasmargins ? cfg.margins[1] : defmargins[1];
+    margin_bottom = cfg.hasmargins ? cfg.margins[2] : defmargins[2];
+    margin_left = cfg.hasmargins ? cfg.margins[3] : defmargins[3];
+    selbpx = cfg.hasselbpx ? cfg.selbpx : defselbpx;
+    normbpx = cfg.hasnormbpx ? cfg.normbpx : defnormbpx;
+
+    /* drop the tables of the previous read */
+    Config old = {0};
+    old.keys = loadedkeys;
+    old.rules = loadedrules;
+    old.nrules = loadedrules ? nruleset : 0;
+    freeconfig(&old);
+
+    bindings = (loadedkeys = cfg.keys) ? cfg.keys : keys;
+    nbindings = cfg.keys ? cfg.nkeys : sizeof(keys) / sizeof(Key);
+    ruleset = (loadedrules = cfg.rules) ? cfg.rules : rules;
+    nruleset = cfg.rules ? cfg.nrules : sizeof(rules) / sizeof(Rule);
+
+    return 1;
+}
+
+/* rereads the config file keeping every client as it is, only the indices
+ * built from the config are rebuilt and windows are reconfigured only if
+ * the new gap or margins actually move them */
+void reload(Arg arg) {
+    (void)arg;
+
+    if (!readconfig()) return;
+
+    setup_rules();
+    grabkeys();
+    updateroot();
+    for (Client *c = head; c; c = c -> next)
+        setborder(c, c -> bw, c == sel ? selbpx : normbpx);
+
+    dirty |= DirtyLayout;
+}
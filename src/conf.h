@@ -0,0 +1,11 @@
+#ifndef CONF_H
+#define CONF_H
+
+#include <stdbool.h>
+
+#include "key.h"
+
+bool readconfig();
+void reload(Arg arg);
+
+#endif
@@ -1,15 +1,28 @@
+#define _GNU_SOURCE
+
 #include <X11/Xlib.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/signalfd.h>
 #include <sys/wait.h>
-#include <signal.h>
+#include <unistd.h>
 
+#include "adopt.h"
 #include "devoid.h"
 #include "events.h"
 #include "ewmh.h"
+#include "dwindle.h"
+#include "focus.h"
+#include "ipc.h"
 #include "key.h"
+#include "conf.h"
 #include "mouse.h"
+#include "restart.h"
+#include "rules.h"
 #include "tags.h"
+#include "stats.h"
+#include "watch.h"
 #include "../config.h"
 
 bool isrunning;
@@ -18,12 +31,21 @@ XWindowAttributes attr;
 int screen;
 Client *head, *sel, *stack;
 unsigned int seltags, selbpx, normbpx;
+unsigned int dirty;
+unsigned long crossingserial;
 struct Root root;
 
-int main() {
+int main(int argc, char *argv[]) {
+    (void)argc;
     start();
     grab();
+    adopt();
     loop();
+    /* reexec() only comes back if there was nothing to exec */
+    while (restarting) {
+        reexec(argv);
+        loop();
+    }
     stop();
     return 0;
 }
@@ -32,8 +54,8 @@ void start() {
     if (!(dpy = XOpenDisplay(0)))
         die("failed to open display");
 
-    /* install a sigchl handler */
-    sigchld(0);
+    /* SIGCHLD, SIGHUP and SIGUSR1 are read off a signalfd by the loop */
+    setup_signals();
 
     /* ignore all X errors */
     XSetErrorHandler(ignore);
@@ -43,13 +65,10 @@ void start() {
 
     /* root window */
     root.win = DefaultRootWindow(dpy);
-    root.x = margin_left;
-    root.y = margin_top;
-    root.w = DW - (margin_left + margin_right);
-    root.h = DH - (margin_top + margin_bottom);
     root.layout = 0;
 
     head = sel = stack = NULL;
+    dirty = 0;
 
     seltags = 1 << 0;
 
@@ -66,14 +85,26 @@ void start() {
     selbpx = getcolor(focused_border_color);
     normbpx = getcolor(normal_border_color);
 
+    /* optional config file, overriding the compiled in values */
+    readconfig();
+    updateroot();
+
     setup_ewmh_atoms();
     setup_cursor();
+    setup_rules();
+    setup_pertag();
+    setup_ipc();
+}
+
+void updateroot() {
+    root.x = margin_left;
+    root.y = margin_top;
+    root.w = DW - (margin_left + margin_right);
+    root.h = DH - (margin_top + margin_bottom);
 }
 
 void grab() {
-    for (size_t i = 0; i < sizeof(keys) / sizeof(Key); i ++)
-        XGrabKey(dpy, XKeysymToKeycode(dpy, keys[i].keysym), keys[i].modifier,
-            root.win, True, GrabModeAsync, GrabModeAsync);
+    grabkeys();
 
     XGrabButton(dpy, 1, MODKEY, root.win, True, ButtonPressMask, GrabModeAsync,
                 GrabModeAsync, None, None);
@@ -81,10 +112,52 @@ void grab() {
                 GrabModeAsync, None, None);
 }
 
+/* poll()s the X connection together with every watched fd, whatever the
+ * callbacks change is laid out by the same flush_pending() as X events */
 void loop() {
     XEvent ev;
-    while (isrunning && !XNextEvent(dpy, &ev))
-        if (handle_events[ev.type]) handle_events[ev.type](&ev);
+    int xfd = ConnectionNumber(dpy);
+
+    while (isrunning) {
+        /* drain everything already queued before doing any relayout */
+        while (isrunning && XPending(dpy)) {
+            XNextEvent(dpy, &ev);
+            handle_event(&ev);
+        }
+        flush_pending();
+
+        /* the flush may have read events off the socket, poll() would not
+         * report those */
+        if (isrunning && !QLength(dpy)) waitfds(xfd);
+    }
+}
+
+/* one layout and focus pass and a single flush per batch of events */
+void flush_pending() {
+    StatMark mark;
+
+    if ((dirty & DirtyLayout) && !getfullscrlock(0)) {
+        stats_begin(&mark);
+        tile();
+        stats_end(StatLayout, &mark);
+    }
+    if (dirty & DirtyFocus) {
+        stats_begin(&mark);
+        applyfocus();
+        stats_end(StatFocus, &mark);
+    }
+    if (dirty & DirtyClients) update_ewmh();
+
+    /* Windows moved under the pointer, the crossing events this causes
+     * carry serials below the marker and are ignored by enternotify()
+     * instead of syncing and discarding the whole queue */
+    if (dirty & DirtyCrossing) {
+        crossingserial = NextRequest(dpy);
+        XNoOp(dpy);
+    }
+    dirty = 0;
+    publish_events();
+    XFlush(dpy);
 }
 
 void stop() {
@@ -92,14 +165,17 @@ void stop() {
     Window root_return, parent_return, *children;
 
     /* Kill every last one of them */
-    if (XQueryTree(dpy, root.win, &parent_return, &root_return, &children, &n))
+    if (ROUNDTRIP(XQueryTree(dpy, root.win, &parent_return, &root_return, &children, &n)))
         for (unsigned int i = 0; i < n; i ++)
-            sendevent(children[i], XInternAtom(dpy, "WM_DELETE_WINDOW", True));
+            sendevent(children[i], wm_atoms[WMDelete]);
 
+    cleanup_ipc();
     XUngrabKey(dpy, AnyKey, AnyModifier, root.win);
-    XSync(dpy, False);
+    ROUNDTRIP(XSync(dpy, False));
     XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
     XDeleteProperty(dpy, root.win, net_atoms[NetActiveWindow]);
+    XDeleteProperty(dpy, root.win, net_atoms[NetClientList]);
+    XDeleteProperty(dpy, root.win, net_atoms[NetClientListStacking]);
     XCloseDisplay(dpy);
 }
 
@@ -108,11 +184,33 @@ void die(char *exit_msg) {
     exit(EXIT_FAILURE);
 }
 
-/* Taken from dwm */
-void sigchld(int unused) {
-    (void)unused;
-    if(signal(SIGCHLD, sigchld) == SIG_ERR) die("Can't install SIGCHLD handler");
-    while(0 < waitpid(-1, NULL, WNOHANG));
+static void readsignals(int fd) {
+    struct signalfd_siginfo si;
+
+    while (read(fd, &si, sizeof(si)) == sizeof(si)) {
+        switch (si.ssi_signo) {
+            case SIGCHLD: while (0 < waitpid(-1, NULL, WNOHANG)); break;
+            case SIGHUP: reload((Arg){0}); break;  /* reread the config file */
+            case SIGUSR1: dumpstats(stderr); break;
+        }
+    }
+}
+
+void setup_signals() {
+    sigset_t set;
+    int fd;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGUSR1);
+    if (sigprocmask(SIG_BLOCK, &set, NULL) < 0 ||
+        (fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+        die("failed to set up signalfd");
+    watchfd(fd, readsignals);
+
+    /* children that exited before the signal was blocked */
+    while (0 < waitpid(-1, NULL, WNOHANG));
 }
 
 int ignore() {
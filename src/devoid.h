@@ -9,16 +9,28 @@
 #define MIN(a, b) (a) < (b) ? (a) : (b)
 #define DW XDisplayWidth(dpy, screen)
 #define DH XDisplayHeight(dpy, screen)
+#define MAXNMASTER 999
 
 void die(char *);
-void sigchld(int);
+void setup_signals();
 int ignore();
 
 void start();
+void updateroot();
 void grab();
 void loop();
+void flush_pending();
 void stop();
 
+/* work deferred to the end of an event batch, DirtyClients covers what
+ * update_ewmh() publishes: the client list, stacking, tags and view */
+enum {
+    DirtyLayout = 1 << 0, DirtyFocus = 1 << 1, DirtyCrossing = 1 << 2,
+    DirtyClients = 1 << 3,
+};
+extern unsigned int dirty;
+extern unsigned long crossingserial;
+
 extern bool isrunning;
 extern Display *dpy;
 extern int screen;
@@ -1,104 +1,223 @@
 #include <X11/Xlib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "dwindle.h"
 #include "client.h"
 #include "devoid.h"
 #include "../config.h"
 
-void shrink(Client *c, int *x, int *y, unsigned int *w, unsigned int *h) {
-    if (c -> width >= c -> height) {
-        c -> width /= 2;
-        *x = c -> x + c -> width;
-        *y = c -> y;
-    } else {
-        c -> height /= 2;
-        *y = c -> y + c -> height;
-        *x = c -> x;
+/* layouts only compute rectangles, tile() is the one sending them to X */
+static void (*layouts[])(Geometry *g, unsigned int n) = {
+    [DWINDLE] = dwindle,
+    [MIRROR_DWINDLE] = mirror_dwindle,
+    [FLOATING] = NULL,
+};
+
+/* the tiled clients and their target rectangles, indexed by tiled position */
+static Client **tiled;
+static unsigned int ntiled;
+
+/* Layout parameters of every tag, views spanning several tags share the
+ * last slot. Each slot also keeps the rectangles it last computed and
+ * what they were computed for. Layouts only depend on the number of tiled
+ * clients and these parameters, so going back to a tag whose tiled set
+ * did not change reuses them without running the layout. */
+typedef struct {
+    unsigned int layout, nmaster;
+    float mratio;
+
+    Geometry *rects, area;
+    unsigned int n, size, cachedlayout, cachednmaster;
+    float cachedmratio;
+} Pertag;
+
+static Pertag pertag[TAGS + 1];
+
+static Pertag* tagslot(unsigned int tags) {
+    int t = tagindex(tags);
+    return &pertag[t < 0 ? TAGS : t];
+}
+
+void setup_pertag() {
+    for (int i = 0; i <= TAGS; i ++) {
+        pertag[i].layout = root.layout;
+        pertag[i].nmaster = nmaster;
+        pertag[i].mratio = mratio;
     }
+}
+
+/* saves the layout parameters of the view being left and loads the ones of
+ * the view in seltags */
+void switchlayout(unsigned int prevtags) {
+    Pertag *prev = tagslot(prevtags), *next = tagslot(seltags);
+    if (prev == next) return;
+
+    prev -> layout = root.layout;
+    prev -> nmaster = nmaster;
+    prev -> mratio = mratio;
 
-    *w = c -> width;
-    *h = c -> height;
+    root.layout = next -> layout;
+    nmaster = next -> nmaster;
+    mratio = next -> mratio;
 }
 
-void dwindle(Client *c, Client *prev, unsigned int i, unsigned int n, unsigned int mw) {
-    if (!c) return;
-
-    if (i == 0) {
-        c -> x = root.x;
-        c -> y = root.y;
-        c -> width = mw;
-        c -> height = root.h;
-    } else if (i < nmaster && i == 1) {
-        prev -> height /= 2;
-        c -> y = prev -> y + prev -> height;
-        c -> x = prev -> x;
-        c -> width = prev -> width;
-        c -> height = prev -> height;
-    } else if (i == nmaster) {
-        c -> x = root.w * mratio;
-        c -> y = root.y;
-        c -> width = root.w * (1 - mratio);
-        c -> height = root.h;
-    } else shrink(prev, &c -> x, &c -> y, &c -> width, &c -> height);
-
-    dwindle(nexttiled(c -> next, 0), c, i + 1, n, mw);
-
-    if (i == n - 1) resize(c);
-    if (prev) resize(prev);
+/* the parameters of every slot as layout, nmaster and the bits of mratio,
+ * for the restart snapshot. mratio has to come back exact or the layout
+ * could move windows by a pixel */
+void getpertag(long *out) {
+    Pertag *cur = tagslot(seltags);
+    uint32_t bits;
+
+    cur -> layout = root.layout;
+    cur -> nmaster = nmaster;
+    cur -> mratio = mratio;
+
+    for (int i = 0; i <= TAGS; i ++) {
+        *out ++ = pertag[i].layout;
+        *out ++ = pertag[i].nmaster;
+        memcpy(&bits, &pertag[i].mratio, sizeof(bits));
+        *out ++ = bits;
+    }
 }
 
-void mirror_dwindle(Client *c, Client *prev, unsigned int i, unsigned int n, unsigned int mw) {
-    if (!c) return;
-
-    if (i == 0) {
-        c -> x = root.x;
-        c -> y = root.y;
-        c -> height = mw;
-        c -> width = root.w;
-    } else if (i < nmaster && i == 1) {
-        prev -> width /= 2;
-        c -> x = prev -> x + prev -> width;
-        c -> y = prev -> y;
-        c -> height = prev -> height;
-        c -> width = prev -> width;
-    } else if (i == nmaster) {
-        c -> y = root.h * mratio;
-        c -> x = root.x;
-        c -> height = root.h * (1 - mratio);
-        c -> width = root.w;
-    } else shrink(prev, &c -> x, &c -> y, &c -> width, &c -> height);
-
-    mirror_dwindle(nexttiled(c -> next, 0), c, i + 1, n, mw);
-
-    if (i == n - 1) resize(c);
-    if (prev) resize(prev);
+/* the reverse, then loads the slot of seltags. Out of range values keep
+ * what the slot had */
+void setpertag(const long *in) {
+    uint32_t bits;
+    float f;
+
+    for (int i = 0; i <= TAGS; i ++, in += 3) {
+        if (in[0] >= 0 && in[0] <= FLOATING) pertag[i].layout = in[0];
+        if (in[1] >= 0 && in[1] <= MAXNMASTER) pertag[i].nmaster = in[1];
+        bits = in[2];
+        memcpy(&f, &bits, sizeof(f));
+        if (f > 0 && f < 1) pertag[i].mratio = f;
+    }
+
+    Pertag *cur = tagslot(seltags);
+    root.layout = cur -> layout;
+    nmaster = cur -> nmaster;
+    mratio = cur -> mratio;
 }
 
-void tile() {
-    if (!head) return;
+static bool cachevalid(Pertag *p, unsigned int n) {
+    return p -> n == n && p -> cachedlayout == root.layout &&
+        p -> cachednmaster == nmaster && p -> cachedmratio == mratio &&
+        p -> area.x == root.x && p -> area.y == root.y &&
+        p -> area.w == root.w && p -> area.h == root.h;
+}
 
-    unsigned int n = 0, mw;
+void shrink(Geometry *prev, Geometry *g) {
+    if (prev -> w >= prev -> h) {
+        prev -> w /= 2;
+        g -> x = prev -> x + prev -> w;
+        g -> y = prev -> y;
+    } else {
+        prev -> h /= 2;
+        g -> y = prev -> y + prev -> h;
+        g -> x = prev -> x;
+    }
 
-    /* calculating total clients */
-    Client *c = nexttiled(head, 0);
-    for (; c; c = nexttiled(c -> next, 0), n ++);
+    g -> w = prev -> w;
+    g -> h = prev -> h;
+}
 
-    switch (root.layout) {
-        case DWINDLE:
-            mw = root.w * (n > nmaster ? mratio : 1);
-            dwindle(nexttiled(head, 0), NULL, 0, n, mw);
-            break;
+void dwindle(Geometry *g, unsigned int n) {
+    unsigned int mw = root.w * (n > nmaster ? mratio : 1);
+
+    for (unsigned int i = 0; i < n; i ++) {
+        if (i == 0) {
+            g[i].x = root.x;
+            g[i].y = root.y;
+            g[i].w = mw;
+            g[i].h = root.h;
+        } else if (i < nmaster && i == 1) {
+            g[i - 1].h /= 2;
+            g[i].y = g[i - 1].y + g[i - 1].h;
+            g[i].x = g[i - 1].x;
+            g[i].w = g[i - 1].w;
+            g[i].h = g[i - 1].h;
+        } else if (i == nmaster) {
+            g[i].x = root.w * mratio;
+            g[i].y = root.y;
+            g[i].w = root.w * (1 - mratio);
+            g[i].h = root.h;
+        } else shrink(&g[i - 1], &g[i]);
+    }
+}
 
-        case MIRROR_DWINDLE:
-            mw = root.h * (n > nmaster ? mratio : 1);
-            mirror_dwindle(nexttiled(head, 0), NULL, 0, n, mw);
-            break;
+void mirror_dwindle(Geometry *g, unsigned int n) {
+    unsigned int mh = root.h * (n > nmaster ? mratio : 1);
+
+    for (unsigned int i = 0; i < n; i ++) {
+        if (i == 0) {
+            g[i].x = root.x;
+            g[i].y = root.y;
+            g[i].h = mh;
+            g[i].w = root.w;
+        } else if (i < nmaster && i == 1) {
+            g[i - 1].w /= 2;
+            g[i].x = g[i - 1].x + g[i - 1].w;
+            g[i].y = g[i - 1].y;
+            g[i].h = g[i - 1].h;
+            g[i].w = g[i - 1].w;
+        } else if (i == nmaster) {
+            g[i].y = root.h * mratio;
+            g[i].x = root.x;
+            g[i].h = root.h * (1 - mratio);
+            g[i].w = root.w;
+        } else shrink(&g[i - 1], &g[i]);
+    }
+}
+
+void tile() {
+    if (!head || !layouts[root.layout]) return;
+
+    unsigned int n = 0;
+    for (Client *c = nexttiled(NULL, 0); c; c = nexttiled(c, 0)) {
+        if (n == ntiled) {
+            ntiled = ntiled ? ntiled * 2 : 16;
+            if (!(tiled = (Client **)realloc(tiled, ntiled * sizeof(Client *))))
+                die("memory allocation failed");
+        }
+        tiled[n ++] = c;
+    }
+    if (!n) return;
+
+    Pertag *p = tagslot(seltags);
+    if (!cachevalid(p, n)) {
+        if (n > p -> size) {
+            p -> size = ntiled;
+            if (!(p -> rects = (Geometry *)realloc(p -> rects, p -> size * sizeof(Geometry))))
+                die("memory allocation failed");
+        }
+
+        layouts[root.layout](p -> rects, n);
+
+        p -> n = n;
+        p -> area = (Geometry){root.x, root.y, root.w, root.h};
+        p -> cachedlayout = root.layout;
+        p -> cachednmaster = nmaster;
+        p -> cachedmratio = mratio;
+    }
+    Geometry *rects = p -> rects;
+
+    /* only windows whose geometry changed get a configure request */
+    for (unsigned int i = 0; i < n; i ++) {
+        tiled[i] -> x = rects[i].x;
+        tiled[i] -> y = rects[i].y;
+        tiled[i] -> width = rects[i].w;
+        tiled[i] -> height = rects[i].h;
+        resize(tiled[i]);
     }
 }
 
 void setlayout(Arg arg) {
+    if (arg.ui >= sizeof(layouts) / sizeof(*layouts)) return;
     if (arg.ui != root.layout) {
         root.layout = arg.ui;
-        tile();
+        dirty |= DirtyLayout;
     }
 }
@@ -5,8 +5,13 @@
 #include "key.h"
 
 void tile();
-void dwindle(Client *c, Client *prev, unsigned int i, unsigned int n, unsigned int mw);
-void shrink(Client *c, int *x, int *y, unsigned int *w, unsigned int *h);
+void dwindle(Geometry *g, unsigned int n);
+void mirror_dwindle(Geometry *g, unsigned int n);
+void shrink(Geometry *prev, Geometry *g);
 void setlayout(Arg);
+void setup_pertag();
+void switchlayout(unsigned int prevtags);
+void getpertag(long *out);
+void setpertag(const long *in);
 
 #endif
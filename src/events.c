@@ -6,12 +6,16 @@
 #include "client.h"
 #include "devoid.h"
 #include "dwindle.h"
+#include "events.h"
 #include "focus.h"
+#include "ipc.h"
 #include "key.h"
 #include "ewmh.h"
 #include "mouse.h"
 #include "rules.h"
 #include "tags.h"
+#include "stats.h"
+#include "../config.h"
 
 /* Taken from dwm */
 bool sendevent(Window win, Atom proto) {
@@ -19,8 +23,12 @@ bool sendevent(Window win, Atom proto) {
     Atom *protocols;
     bool exists = false;
     XEvent ev;
+    Client *c;
 
-    if (XGetWMProtocols(dpy, win, &protocols, &n)) {
+    /* managed windows answer from their cached protocols */
+    if ((c = wintoclient(win)) && protomask(proto))
+        exists = c -> protocols & protomask(proto);
+    else if (ROUNDTRIP(XGetWMProtocols(dpy, win, &protocols, &n))) {
         while (!exists && n--) exists = protocols[n] == proto;
         XFree(protocols);
     }
@@ -28,7 +36,7 @@ bool sendevent(Window win, Atom proto) {
     if (exists) {
         ev.type = ClientMessage;
         ev.xclient.window = win;
-        ev.xclient.message_type = XInternAtom(dpy, "WM_PROTOCOLS", True);
+        ev.xclient.message_type = wm_atoms[WMProtocols];
         ev.xclient.format = 32;
         ev.xclient.data.l[0] = proto;
         ev.xclient.data.l[1] = CurrentTime;
@@ -37,6 +45,16 @@ bool sendevent(Window win, Atom proto) {
     return exists;
 }
 
+/* runs the handler of an event, accounting its cost */
+void handle_event(XEvent *event) {
+    StatMark mark;
+
+    if (!handle_events[event -> type]) return;
+    stats_begin(&mark);
+    handle_events[event -> type](event);
+    stats_end(event -> type, &mark);
+}
+
 void keypress(XEvent *event) {
     handle_keypress(event);
 }
@@ -59,7 +77,7 @@ void maprequest(XEvent *event) {
 
     XMapRequestEvent *ev = &event -> xmaprequest;
 
-    if (!(XGetWindowAttributes(dpy, ev -> window, &attr))) return;
+    if (!ROUNDTRIP(XGetWindowAttributes(dpy, ev -> window, &attr))) return;
 
     /* docs says window managers must ignore such windows */
     if (attr.override_redirect) return;
@@ -77,23 +95,31 @@ void maprequest(XEvent *event) {
     }
 
     c = newclient(ev -> window);
+    c -> geom = (Geometry){attr.x, attr.y, attr.width, attr.height};
+
+    /* the border color a window starts with is unknown */
+    c -> bw = attr.border_width;
+    c -> bpx = normbpx;
+    XSetWindowBorder(dpy, c -> win, normbpx);
 
     attach(c);
+    update_protocols(c);
     apply_window_state(c);
     apply_rules(c);
 
+    setborder(c, border_width, normbpx);
+
     if (c -> isfloating) {
-        XGetWindowAttributes(dpy, c -> win, &attr);
-        c -> x = attr.x;
-        c -> y = attr.y;
-        c -> width = attr.width;
-        c -> height = attr.height;
+        c -> x = c -> geom.x;
+        c -> y = c -> geom.y;
+        c -> width = c -> geom.w;
+        c -> height = c -> geom.h;
     } else if (c -> isfullscr) lock_fullscr(c);
-    else tile();
+    else dirty |= DirtyLayout;
 
     XMapWindow(dpy, ev -> window);
     focus(c);
-    XSync(dpy, True);
+    notify_window(c -> win, 1);
 }
 
 void destroynotify(XEvent *event) {
@@ -102,20 +128,21 @@ void destroynotify(XEvent *event) {
     if (!(c = wintoclient(ev -> window))) return;
     detach(c);
     detachstack(c);
-    if (isvisible(c, 0)) {
-        if (!c -> isfloating || c -> isfullscr) tile();
+    if (isvisible(c, 0) || c == sel) {
+        if (!c -> isfloating || c -> isfullscr) dirty |= DirtyLayout;
         focus(NULL);
     }
     if (getfullscrlock(c -> tags)) unlock_fullscr(c);
     XDestroyWindow(dpy, ev -> window);
-    free(c);
-    XSync(dpy, True);
+    notify_window(c -> win, 0);
+    freeclient(c);
 }
 
 void enternotify(XEvent *event) {
     if (sel == NULL) return;
     XCrossingEvent *ev = &event -> xcrossing;
     Client *c = NULL;
+    if (ev -> serial < crossingserial) return;
     if ((c = wintoclient(ev -> window))) focus(c);
 }
 
@@ -141,26 +168,54 @@ void unmapnotify(XEvent *event) {
     if ((c = wintoclient(ev -> window))) {
 		if (ev -> send_event) {
             long data[] = {WithdrawnState, None};
-            XChangeProperty(dpy, c->win, XInternAtom(dpy, "WM_STATE", False),
-                            XInternAtom(dpy, "WM_STATE", False), 32,
+            XChangeProperty(dpy, c->win, wm_atoms[WMState], wm_atoms[WMState], 32,
                             PropModeReplace, (unsigned char *)data, 2);
         } else {
             if (ev->send_event) {
                 long data[] = { WithdrawnState, None };
-                XChangeProperty(dpy, c->win, XInternAtom(dpy, "WM_STATE", False),
-                                XInternAtom(dpy, "WM_STATE", False), 32,
+                XChangeProperty(dpy, c->win, wm_atoms[WMState], wm_atoms[WMState], 32,
                                 PropModeReplace, (unsigned char *)data, 2);
             } else {
                 detach(c);
                 detachstack(c);
-                free(c);
-                tile();
+                notify_window(c -> win, 0);
+                freeclient(c);
+                dirty |= DirtyLayout;
                 focus(NULL);
             }
         }
     }
 }
 
+/* keeps the tracked geometry authoritative if something other than us
+ * moved the window, notifications for our own requests are stale once a
+ * newer request has been sent */
+void configurenotify(XEvent *event) {
+    XConfigureEvent *ev = &event -> xconfigure;
+    Client *c;
+
+    if (!(c = wintoclient(ev -> window)) || c -> ishidden) return;
+    if (ev -> serial < c -> serial) return;
+
+    c -> geom = (Geometry){ev -> x, ev -> y, ev -> width, ev -> height};
+}
+
+void propertynotify(XEvent *event) {
+    XPropertyEvent *ev = &event -> xproperty;
+    Client *c;
+
+    if (ev -> atom == wm_atoms[WMProtocols] && (c = wintoclient(ev -> window)))
+        update_protocols(c);
+}
+
+void mappingnotify(XEvent *event) {
+    XMappingEvent *ev = &event -> xmapping;
+
+    XRefreshKeyboardMapping(ev);
+    if (ev -> request == MappingKeyboard || ev -> request == MappingModifier)
+        grabkeys();
+}
+
 void configurerequest(XEvent *event) {
     Client *c;
     XConfigureRequestEvent *ev = &event -> xconfigurerequest;
@@ -189,4 +244,7 @@ void (*handle_events[LASTEvent])(XEvent *event) = {
     [ClientMessage] = clientmessage,
     [UnmapNotify] = unmapnotify,
     [ConfigureRequest] = configurerequest,
+    [ConfigureNotify] = configurenotify,
+    [PropertyNotify] = propertynotify,
+    [MappingNotify] = mappingnotify,
 };
@@ -4,6 +4,7 @@
 #include <X11/Xlib.h>
 
 bool sendevent(Window win, Atom proto);
+void handle_event(XEvent *event);
 
 /* event handlers */
 void keypress(XEvent *event);
@@ -16,6 +17,9 @@ void enternotify(XEvent *event);
 void clientmessage(XEvent *event);
 void unmapnotify(XEvent *event);
 void configurerequest(XEvent *event);
+void configurenotify(XEvent *event);
+void propertynotify(XEvent *event);
+void mappingnotify(XEvent *event);
 
 extern void (*handle_events[LASTEvent])(XEvent *event);
 
@@ -1,18 +1,60 @@
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "ewmh.h"
 #include "devoid.h"
+#include "stats.h"
 
+Atom wm_atoms[WMLast];
 Atom net_atoms[NetLast];
+Atom snapshot_atom;
+static Atom utf8string;
+
+/* a list of windows as last written to a root property */
+typedef struct {
+    Window *w;
+    unsigned int n, size;
+} WinList;
+
+static WinList clientlist, stacking, raised, scratch;
+static long curdesktop = -1;
+
+static char *wm_atom_names[WMLast] = {
+    [WMProtocols] = "WM_PROTOCOLS",
+    [WMDelete] = "WM_DELETE_WINDOW",
+    [WMState] = "WM_STATE",
+    [WMTakeFocus] = "WM_TAKE_FOCUS",
+};
+
+static char *net_atom_names[NetLast] = {
+    [NetSupported] = "_NET_SUPPORTED",
+    [NetCurrentDesktop] = "_NET_CURRENT_DESKTOP",
+    [NetNumberOfDesktops] = "_NET_NUMBER_OF_DESKTOPS",
+    [NetWMWindowType] = "_NET_WM_WINDOW_TYPE",
+    [NetWMWindowTypeDialog] = "_NET_WM_WINDOW_TYPE_DIALOG",
+    [NetWMWindowTypeMenu] = "_NET_WM_WINDOW_TYPE_MENU",
+    [NetWMWindowTypeSplash] = "_NET_WM_WINDOW_TYPE_SPLASH",
+    [NetWMWindowTypeToolbar] = "_NET_WM_WINDOW_TYPE_TOOLBAR",
+    [NetWMWindowTypeUtility] = "_NET_WM_WINDOW_TYPE_UTILITY",
+    [NetWMState] = "_NET_WM_STATE",
+    [NetWMStateFullscreen] = "_NET_WM_STATE_FULLSCREEN",
+    [NetWMStateAbove] = "_NET_WM_STATE_ABOVE",
+    [NetActiveWindow] = "_NET_ACTIVE_WINDOW",
+    [NetClientList] = "_NET_CLIENT_LIST",
+    [NetClientListStacking] = "_NET_CLIENT_LIST_STACKING",
+    [NetWMDesktop] = "_NET_WM_DESKTOP",
+    [NetDesktopNames] = "_NET_DESKTOP_NAMES",
+};
 
 Atom get_atom_prop(Window win, Atom atom) {
     Atom prop = (unsigned long)NULL, da;
     unsigned char *prop_ret = NULL;
     int di;
     unsigned long dl;
-    if (XGetWindowProperty(dpy, win, atom, 0, 1, False, XA_ATOM, &da, &di, &dl, &dl, &prop_ret)
-        == Success) {
+    if (ROUNDTRIP(XGetWindowProperty(dpy, win, atom, 0, 1, False, XA_ATOM, &da, &di,
+                                     &dl, &dl, &prop_ret)) == Success) {
         if (prop_ret) {
             prop = ((Atom *)prop_ret)[0];
             XFree(prop_ret);
@@ -21,40 +63,182 @@ Atom get_atom_prop(Window win, Atom atom) {
     return prop;
 }
 
+/* interns every atom devoidwm uses in a single round trip */
 void setup_ewmh_atoms() {
-    net_atoms[NetSupported] = GETATOMID("_NET_SUPPORTED");
-    net_atoms[NetNumberOfDesktops] = GETATOMID("_NET_NUMBER_OF_DESKTOPS");
-    net_atoms[NetCurrentDesktop] = GETATOMID("_NET_CURRENT_DESKTOP");
-    net_atoms[NetWMState] = GETATOMID("_NET_WM_STATE");
-    net_atoms[NetWMStateFullscreen] = GETATOMID("_NET_WM_STATE_FULLSCREEN");
-    net_atoms[NetWMStateAbove] = GETATOMID("_NET_WM_STATE_ABOVE");
-    net_atoms[NetWMWindowType] = GETATOMID("_NET_WM_WINDOW_TYPE");
-    net_atoms[NetWMWindowTypeDialog] = GETATOMID("_NET_WM_WINDOW_TYPE_DIALOG");
-    net_atoms[NetWMWindowTypeMenu] = GETATOMID("_NET_WM_WINDOW_TYPE_MENU");
-    net_atoms[NetWMWindowTypeSplash] = GETATOMID("_NET_WM_WINDOW_TYPE_SPLASH");
-    net_atoms[NetWMWindowTypeToolbar] = GETATOMID("_NET_WM_WINDOW_TYPE_TOOLBAR");
-    net_atoms[NetWMWindowTypeUtility] = GETATOMID("_NET_WM_WINDOW_TYPE_UTILITY");
-    net_atoms[NetActiveWindow] = GETATOMID("_NET_ACTIVE_WINDOW");
+    char *names[WMLast + NetLast + 2];
+    Atom atoms[WMLast + NetLast + 2];
+    char desktops[TAGS * 2];
+    long ndesktops = TAGS;
+    int i;
+
+    for (i = 0; i < WMLast; i ++) names[i] = wm_atom_names[i];
+    for (i = 0; i < NetLast; i ++) names[WMLast + i] = net_atom_names[i];
+    names[WMLast + NetLast] = "UTF8_STRING";
+    names[WMLast + NetLast + 1] = "_DEVOID_SNAPSHOT";
+
+    if (!ROUNDTRIP(XInternAtoms(dpy, names, WMLast + NetLast + 2, False, atoms)))
+        die("failed to intern atoms");
+
+    for (i = 0; i < WMLast; i ++) wm_atoms[i] = atoms[i];
+    for (i = 0; i < NetLast; i ++) net_atoms[i] = atoms[WMLast + i];
+    utf8string = atoms[WMLast + NetLast];
+    snapshot_atom = atoms[WMLast + NetLast + 1];
 
     CHANGEATOMPROP(net_atoms[NetSupported], XA_ATOM,
                 (unsigned char *)net_atoms, NetLast);
+
+    /* the tags never change, their names are "1" to "9" */
+    for (i = 0; i < TAGS; i ++) {
+        desktops[i * 2] = '1' + i;
+        desktops[i * 2 + 1] = '\0';
+    }
+    CHANGEATOMPROP(net_atoms[NetNumberOfDesktops], XA_CARDINAL,
+                   (unsigned char *)&ndesktops, 1);
+    XChangeProperty(dpy, root.win, net_atoms[NetDesktopNames], utf8string, 8,
+                    PropModeReplace, (unsigned char *)desktops, sizeof(desktops));
+
+    /* left over from a previous wm, update_ewmh() appends to these */
+    XDeleteProperty(dpy, root.win, net_atoms[NetClientList]);
+    XDeleteProperty(dpy, root.win, net_atoms[NetClientListStacking]);
+    dirty |= DirtyClients;
+}
+
+unsigned int protomask(Atom proto) {
+    if (proto == wm_atoms[WMDelete]) return ProtoDelete;
+    if (proto == wm_atoms[WMTakeFocus]) return ProtoTakeFocus;
+    return 0;
+}
+
+/* refreshes the protocols cached on the client, done when it is mapped and
+ * whenever its WM_PROTOCOLS property changes */
+void update_protocols(Client *c) {
+    int n;
+    Atom *protocols;
+
+    c -> protocols = 0;
+    if (ROUNDTRIP(XGetWMProtocols(dpy, c -> win, &protocols, &n))) {
+        while (n--) c -> protocols |= protomask(protocols[n]);
+        XFree(protocols);
+    }
 }
 
 void apply_window_state(Client *c) {
+    Atom type = get_atom_prop(c -> win, net_atoms[NetWMWindowType]);
+
+    /* the state is only asked for when the type does not decide already */
+    set_window_state(c, type, None);
+    if (!c -> isfloating)
+        set_window_state(c, type, get_atom_prop(c -> win, net_atoms[NetWMState]));
+}
+
+/* from the first atom of _NET_WM_WINDOW_TYPE and _NET_WM_STATE */
+void set_window_state(Client *c, Atom type, Atom state) {
     c -> isfloating = 0;
     c -> isfullscr = 0;
 
-    Atom prop = get_atom_prop(c -> win, net_atoms[NetWMWindowType]);
-    if (prop == net_atoms[NetWMWindowTypeDialog] ||
-            prop == net_atoms[NetWMWindowTypeMenu] ||
-            prop == net_atoms[NetWMWindowTypeSplash] ||
-            prop == net_atoms[NetWMWindowTypeToolbar] ||
-            prop == net_atoms[NetWMWindowTypeUtility]) {
+    if (type == net_atoms[NetWMWindowTypeDialog] ||
+            type == net_atoms[NetWMWindowTypeMenu] ||
+            type == net_atoms[NetWMWindowTypeSplash] ||
+            type == net_atoms[NetWMWindowTypeToolbar] ||
+            type == net_atoms[NetWMWindowTypeUtility]) {
         c -> isfloating = 1;
         return;
     }
 
-    prop = get_atom_prop(c -> win, net_atoms[NetWMState]);
-    if (prop == net_atoms[NetWMStateAbove]) c -> isfloating = 1;
-    else if (prop == net_atoms[NetWMStateFullscreen]) c -> isfullscr = 1;
+    if (state == net_atoms[NetWMStateAbove]) c -> isfloating = 1;
+    else if (state == net_atoms[NetWMStateFullscreen]) c -> isfullscr = 1;
+}
+
+static void push(WinList *l, Window w) {
+    if (l -> n == l -> size) {
+        l -> size = l -> size ? l -> size * 2 : 64;
+        if (!(l -> w = (Window *)realloc(l -> w, l -> size * sizeof(Window))))
+            die("memory allocation failed");
+    }
+    l -> w[l -> n ++] = w;
+}
+
+static bool inlist(WinList *l, unsigned int n, Window w) {
+    for (unsigned int i = 0; i < n; i ++)
+        if (l -> w[i] == w) return 1;
+    return 0;
+}
+
+/* raises win, _NET_CLIENT_LIST_STACKING follows at the end of the batch */
+void raisewindow(Window win) {
+    XRaiseWindow(dpy, win);
+    push(&raised, win);
+    dirty |= DirtyClients;
+}
+
+/* Rebuilds the list from what was last published: windows that are gone
+ * drop out, the ones in top (if any) move to the end and windows not
+ * published yet are added after them, so the order of the rest is kept
+ * as mapped or stacked. Nothing is written if the list is unchanged and
+ * only the new tail is appended if nothing else moved. */
+static void syncwinlist(WinList *pub, Atom prop, WinList *top, unsigned int nclients) {
+    unsigned int i, kept;
+
+    scratch.n = 0;
+    for (i = 0; i < pub -> n; i ++)
+        if (wintoclient(pub -> w[i]) && !(top && inlist(top, top -> n, pub -> w[i])))
+            push(&scratch, pub -> w[i]);
+    kept = scratch.n;
+
+    for (i = 0; top && i < top -> n; i ++)
+        if (wintoclient(top -> w[i]) && !inlist(&scratch, scratch.n, top -> w[i]))
+            push(&scratch, top -> w[i]);
+
+    if (scratch.n < nclients)
+        for (Client *c = head; c; c = c -> next)
+            if (!inlist(&scratch, scratch.n, c -> win)) push(&scratch, c -> win);
+
+    if (scratch.n == pub -> n && !memcmp(scratch.w, pub -> w, scratch.n * sizeof(Window)))
+        return;
+
+    /* everything published is still there in the same order */
+    if (kept == pub -> n)
+        XChangeProperty(dpy, root.win, prop, XA_WINDOW, 32, PropModeAppend,
+                        (unsigned char *)(scratch.w + kept), scratch.n - kept);
+    else
+        XChangeProperty(dpy, root.win, prop, XA_WINDOW, 32, PropModeReplace,
+                        (unsigned char *)scratch.w, scratch.n);
+
+    WinList tmp = *pub;
+    *pub = scratch;
+    scratch = tmp;
+}
+
+/* the lowest tag, or 0xFFFFFFFF for a window on all of them */
+static long desktopof(unsigned int tags) {
+    if ((tags & TAGMASK) == TAGMASK) return 0xFFFFFFFF;
+    for (long i = 0; i < TAGS; i ++)
+        if (tags & 1 << i) return i;
+    return 0;
+}
+
+/* called from flush_pending() for batches marked DirtyClients, every
+ * property is compared with what it was last set to and written only if
+ * it differs */
+void update_ewmh() {
+    unsigned int n = 0;
+    long desktop;
+
+    for (Client *c = head; c; c = c -> next, n ++) {
+        if ((desktop = desktopof(c -> tags)) == c -> desktop) continue;
+        c -> desktop = desktop;
+        XChangeProperty(dpy, c -> win, net_atoms[NetWMDesktop], XA_CARDINAL, 32,
+                        PropModeReplace, (unsigned char *)&desktop, 1);
+    }
+
+    if ((desktop = desktopof(seltags)) == 0xFFFFFFFF) desktop = 0;
+    if (desktop != curdesktop) {
+        curdesktop = desktop;
+        CHANGEATOMPROP(net_atoms[NetCurrentDesktop], XA_CARDINAL,
+                       (unsigned char *)&desktop, 1);
+    }
+
+    syncwinlist(&clientlist, net_atoms[NetClientList], NULL, n);
+    syncwinlist(&stacking, net_atoms[NetClientListStacking], &raised, n);
+    raised.n = 0;
 }
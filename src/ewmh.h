@@ -9,18 +9,30 @@
 #define CHANGEATOMPROP(prop, type, data, nelments) \
     XChangeProperty(dpy, root.win, prop, type, 32, PropModeReplace, data, nelments);
 
-#define GETATOMID(name) XInternAtom(dpy, name, False)
+/* ICCCM atoms */
+enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast };
+
+/* bits of Client.protocols */
+enum { ProtoDelete = 1 << 0, ProtoTakeFocus = 1 << 1 };
 
 /* EWMH atoms */
 enum { NetSupported, NetCurrentDesktop, NetNumberOfDesktops, NetWMWindowType,
     NetWMWindowTypeDialog, NetWMWindowTypeMenu, NetWMWindowTypeSplash,
     NetWMWindowTypeToolbar, NetWMWindowTypeUtility, NetWMState,
-    NetWMStateFullscreen, NetWMStateAbove, NetActiveWindow, NetLast };
+    NetWMStateFullscreen, NetWMStateAbove, NetActiveWindow, NetClientList,
+    NetClientListStacking, NetWMDesktop, NetDesktopNames, NetLast };
 
+extern Atom wm_atoms[WMLast];
 extern Atom net_atoms[NetLast];
+extern Atom snapshot_atom; /* _DEVOID_SNAPSHOT, see restart.c */
 
 Atom get_atom_prop(Window win, Atom atom);
 void setup_ewmh_atoms();
 void apply_window_state(Client *c);
+void set_window_state(Client *c, Atom type, Atom state);
+unsigned int protomask(Atom proto);
+void update_protocols(Client *c);
+void raisewindow(Window win);
+void update_ewmh();
 
 #endif
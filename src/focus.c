@@ -6,42 +6,57 @@
 #include "tags.h"
 #include "../config.h"
 
+/* the window applyfocus() last gave the focused border to */
+static Window focusedwin;
+
+/* selects c (or the most recently focused visible client) and marks the
+ * focus dirty, the X side is done once per event batch by applyfocus() */
 void focus(Client *c) {
+    dirty |= DirtyFocus;
+
     if (!c || !isvisible(c, 0)) {
         for (c = stack; c && !isvisible(c, 0); c = c -> snext);
         if (!c) {
-            XSetInputFocus(dpy, root.win, RevertToPointerRoot, CurrentTime);
-            XDeleteProperty(dpy, root.win, net_atoms[NetActiveWindow]);
             sel = NULL;
             return;
         }
     }
 
-    for (Client *i = nextvisible(head, 0); i; i = nextvisible(i -> next, 0)) {
-        if (i -> isfullscr) continue;
-        XSetWindowBorderWidth(dpy, i -> win, border_width);
-        if (i == c) XSetWindowBorder(dpy, i -> win, selbpx);
-        else XSetWindowBorder(dpy, i -> win, normbpx);
+    detachstack(c);
+    attachstack(c);
+    sel = c;
+}
+
+/* only the previously and newly focused windows get their border
+ * repainted, and only if it actually changes */
+void applyfocus() {
+    Client *prev = wintoclient(focusedwin);
+    if (prev && prev != sel) setborder(prev, prev -> bw, normbpx);
+
+    if (!sel) {
+        focusedwin = None;
+        XSetInputFocus(dpy, root.win, RevertToPointerRoot, CurrentTime);
+        XDeleteProperty(dpy, root.win, net_atoms[NetActiveWindow]);
+        return;
     }
 
-    XSetInputFocus(dpy, c -> win, RevertToPointerRoot, CurrentTime);
+    focusedwin = sel -> win;
+    setborder(sel, sel -> bw, selbpx);
 
-    if (c -> isfloating) XRaiseWindow(dpy, c -> win);
+    XSetInputFocus(dpy, sel -> win, RevertToPointerRoot, CurrentTime);
 
-    CHANGEATOMPROP(net_atoms[NetActiveWindow], XA_WINDOW,
-                   (unsigned char *)&c -> win, 1);
-    sendevent(c -> win, XInternAtom(dpy, "WM_TAKE_FOCUS", False));
+    if (sel -> isfloating) raisewindow(sel -> win);
 
-    detachstack(c);
-    attachstack(c);
-    sel = c;
+    CHANGEATOMPROP(net_atoms[NetActiveWindow], XA_WINDOW,
+                   (unsigned char *)&sel -> win, 1);
+    sendevent(sel -> win, wm_atoms[WMTakeFocus]);
 }
 
 void focus_adjacent(Arg arg) {
     if (!sel || getfullscrlock(0)) return;
 
     if (arg.i > 0) {
-        Client *next = nextvisible(sel -> next, 0);
+        Client *next = nextvisible(sel, 0);
         if (next) focus(next);
         else focus(get_visible_head());
     } else {
@@ -52,22 +67,18 @@ void focus_adjacent(Arg arg) {
 }
 
 void attachstack(Client *c) {
+    c -> sprev = NULL;
     c -> snext = stack;
+    if (stack) stack -> sprev = c;
     stack = c;
 }
 
 void detachstack(Client *c) {
-    if (!stack) return;
+    /* not on the stack yet */
+    if (!c -> sprev && stack != c) return;
 
-    if (stack == c) {
-        stack = stack -> snext;
-        return;
-    }
-
-    Client *i = stack;
-    while (i -> snext != c) {
-        i = i -> snext;
-        if (!i) return;
-    }
-    i -> snext = c -> snext;
+    if (c -> sprev) c -> sprev -> snext = c -> snext;
+    else stack = c -> snext;
+    if (c -> snext) c -> snext -> sprev = c -> sprev;
+    c -> snext = c -> sprev = NULL;
 }
@@ -4,6 +4,7 @@
 #include "client.h"
 
 void focus(Client *c);
+void applyfocus();
 void focus_adjacent(Arg arg);
 void attachstack(Client *c);
 void detachstack(Client *c);
@@ -0,0 +1,464 @@
+#define _GNU_SOURCE
+
+#include <X11/Xlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "devoid.h"
+#include "ipc.h"
+#include "key.h"
+#include "stats.h"
+#include "watch.h"
+#include "../config.h"
+
+/* Control socket, $DEVOID_SOCKET, $XDG_RUNTIME_DIR/devoid-<display>.sock or
+ * /tmp/devoid-<uid>-<display>.sock, so ":0" gets devoid-0.sock. Every line
+ * sent is one batch of commands separated by ';' and gets exactly one line
+ * of json back:
+ *
+ *     view 2; setlayout floating; get tags
+ *     {"ok":true,"reply":[null,null,{"selected":2,...}]}
+ *
+ * Commands are the actions of the config file (bind) plus the queries
+ * "get state|clients|focused|tags|stats". The whole batch is parsed before
+ * anything runs, so a bad command leaves everything untouched and answers
+ * {"ok":false,"error":"..."} instead.
+ *
+ * "subscribe focus|view|layout|window|fullscreen" (or plain "subscribe"
+ * for all of them) makes the connection an event stream as well. Events are
+ * pushed once per batch from flush_pending(), one json line each:
+ *
+ *     {"event":"view","tags":2}
+ *     {"event":"focus","win":8388614}
+ *
+ * so "get state; subscribe" gives a status bar its initial state followed
+ * by every change, without polling anything. */
+
+#define IPCBUFSIZE 4096
+#define MAXBATCH 64
+
+typedef struct Conn {
+    int fd;
+    size_t len;
+    char buf[IPCBUFSIZE];
+    unsigned int events;  /* subscriptions */
+    struct Conn *next;
+} Conn;
+
+typedef struct {
+    const Action *action;
+    Arg arg;
+    void (*query)(FILE *out);
+    unsigned int subscribe;
+} Command;
+
+/* map/unmap and fullscreen changes, the rest is diffed against last* */
+typedef struct {
+    unsigned int type;
+    Window win;
+    bool on;
+} Pending;
+
+static void putstate(FILE *out);
+static void putclients(FILE *out);
+static void putfocused(FILE *out);
+static void puttags(FILE *out);
+
+static const struct {
+    const char *name;
+    void (*write)(FILE *out);
+} queries[] = {
+    {"state", putstate},
+    {"clients", putclients},
+    {"focused", putfocused},
+    {"tags", puttags},
+    {"stats", writestats},
+};
+
+static const char *eventnames[] = {"focus", "view", "layout", "window", "fullscreen"};
+
+static int sockfd = -1;
+static char sockpath[sizeof(((struct sockaddr_un *)0) -> sun_path)];
+static Conn *conns;
+static unsigned int subscribed;  /* all connections' subscriptions or'ed */
+static bool serving;  /* inside readconn(), see publish_events() */
+
+static Pending *pending;
+static unsigned int npending, pendingsize;
+static Window lastfocus;
+static unsigned int lastview, lastlayout, lastnmaster;
+static float lastmratio;
+
+static void putstring(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s ++) {
+        if (*s == '"' || *s == '\\') fprintf(out, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20) fprintf(out, "\\u%04x", *s);
+        else fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void putclient(FILE *out, Client *c) {
+    fprintf(out, "{\"win\":%lu,\"tags\":%u,\"floating\":%s,\"fullscreen\":%s,"
+            "\"hidden\":%s,\"x\":%d,\"y\":%d,\"w\":%u,\"h\":%u}",
+            c -> win, c -> tags, c -> isfloating ? "true" : "false",
+            c -> isfullscr ? "true" : "false", c -> ishidden ? "true" : "false",
+            c -> geom.x, c -> geom.y, c -> geom.w, c -> geom.h);
+}
+
+static void putclients(FILE *out) {
+    fputc('[', out);
+    for (Client *c = head; c; c = c -> next) {
+        if (c != head) fputc(',', out);
+        putclient(out, c);
+    }
+    fputc(']', out);
+}
+
+static void putfocused(FILE *out) {
+    if (sel) putclient(out, sel);
+    else fputs("null", out);
+}
+
+static void puttags(FILE *out) {
+    unsigned int occupied = 0;
+    const char *name = layoutname(root.layout);
+
+    for (Client *c = head; c; c = c -> next) occupied |= c -> tags;
+    fprintf(out, "{\"selected\":%u,\"occupied\":%u,\"layout\":", seltags, occupied);
+    putstring(out, name ? name : "");
+    fprintf(out, ",\"nmaster\":%u,\"mratio\":%.2f}", nmaster, mratio);
+}
+
+static void putstate(FILE *out) {
+    fputs("{\"tags\":", out);
+    puttags(out);
+    fputs(",\"focused\":", out);
+    putfocused(out);
+    fputs(",\"clients\":", out);
+    putclients(out);
+    fputc('}', out);
+}
+
+static void fail(FILE *out, const char *what, const char *name) {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s%s", what, name ? name : "");
+    fputs("{\"ok\":false,\"error\":", out);
+    putstring(out, msg);
+    fputs("}\n", out);
+}
+
+/* parses one command, NULL on success or what went wrong */
+static const char* parsecommand(char *s, Command *cmd) {
+    char *save, *name, *value;
+
+    name = strtok_r(s, " \t\r", &save);
+    value = strtok_r(NULL, " \t\r", &save);
+    if (strtok_r(NULL, " \t\r", &save)) return "too many arguments for ";
+
+    cmd -> action = NULL;
+    cmd -> query = NULL;
+    cmd -> subscribe = 0;
+    if (!strcmp(name, "subscribe")) {
+        for (size_t i = 0; value && i < sizeof(eventnames) / sizeof(*eventnames); i ++)
+            if (!strcmp(eventnames[i], value)) cmd -> subscribe = 1 << i;
+        if (!value) cmd -> subscribe = EvAll;
+        return cmd -> subscribe ? NULL : "unknown event for ";
+    }
+    if (!strcmp(name, "get")) {
+        for (size_t i = 0; value && i < sizeof(queries) / sizeof(*queries); i ++)
+            if (!strcmp(queries[i].name, value)) cmd -> query = queries[i].write;
+        return cmd -> query ? NULL : "unknown query for ";
+    }
+    if (!(cmd -> action = getaction(name))) return "unknown command ";
+    if (!parsearg(cmd -> action, value, &cmd -> arg)) return "bad argument for ";
+    return NULL;
+}
+
+/* runs one line worth of commands and writes its reply to out */
+static void runbatch(Conn *conn, char *line, FILE *out) {
+    Command cmds[MAXBATCH];
+    unsigned int n = 0;
+    char *save, *s, *name;
+    const char *err;
+
+    for (s = strtok_r(line, ";", &save); s; s = strtok_r(NULL, ";", &save)) {
+        name = s + strspn(s, " \t\r");
+        if (!*name) continue;
+        if (n == MAXBATCH) {
+            fail(out, "too many commands", NULL);
+            return;
+        }
+        /* parsecommand() leaves name cut down to the command itself */
+        if ((err = parsecommand(name, &cmds[n ++]))) {
+            fail(out, err, name);
+            return;
+        }
+    }
+
+    fputs("{\"ok\":true,\"reply\":[", out);
+    for (unsigned int i = 0; i < n; i ++) {
+        if (i) fputc(',', out);
+        if (cmds[i].subscribe) {
+            conn -> events |= cmds[i].subscribe;
+            subscribed |= cmds[i].subscribe;
+            fputs("null", out);
+        } else if (cmds[i].query) {
+            /* answer with the state the earlier commands left, laid out */
+            if (dirty) flush_pending();
+            cmds[i].query(out);
+        } else {
+            cmds[i].action -> execute(cmds[i].arg);
+            fputs("null", out);
+        }
+    }
+    fputs("]}\n", out);
+}
+
+static void closeconn(Conn *conn) {
+    Conn **p;
+    for (p = &conns; *p != conn; p = &(*p) -> next);
+    *p = conn -> next;
+
+    unwatchfd(conn -> fd);
+    close(conn -> fd);
+    free(conn);
+
+    subscribed = 0;
+    for (conn = conns; conn; conn = conn -> next) subscribed |= conn -> events;
+}
+
+/* a client that does not keep up with its replies is dropped rather than
+ * blocking the wm */
+static bool sendreply(Conn *conn, const char *buf, size_t len) {
+    ssize_t n;
+    while (len) {
+        if ((n = send(conn -> fd, buf, len, MSG_NOSIGNAL)) < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static void readconn(int fd) {
+    Conn *conn;
+    char *line, *nl, *reply;
+    size_t len;
+    ssize_t n;
+    FILE *out;
+
+    for (conn = conns; conn && conn -> fd != fd; conn = conn -> next);
+    if (!conn) return;
+
+    n = read(fd, conn -> buf + conn -> len, sizeof(conn -> buf) - conn -> len);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (n <= 0) {
+        closeconn(conn);
+        return;
+    }
+    conn -> len += n;
+
+    if (!(out = open_memstream(&reply, &len))) die("memory allocation failed");
+    serving = 1;
+    for (line = conn -> buf; (nl = memchr(line, '\n', conn -> buf + conn -> len - line));
+         line = nl + 1) {
+        *nl = '\0';
+        runbatch(conn, line, out);
+    }
+    serving = 0;
+    conn -> len -= line - conn -> buf;
+    memmove(conn -> buf, line, conn -> len);
+    if (conn -> len == sizeof(conn -> buf)) fail(out, "line too long", NULL);
+    fclose(out);
+
+    if (!sendreply(conn, reply, len) || conn -> len == sizeof(conn -> buf))
+        closeconn(conn);
+    free(reply);
+}
+
+static void acceptconn(int fd) {
+    Conn *conn;
+    int cfd;
+
+    while ((cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (!(conn = (Conn *)malloc(sizeof(Conn)))) die("memory allocation failed");
+        conn -> fd = cfd;
+        conn -> len = 0;
+        conn -> next = conns;
+        conns = conn;
+        watchfd(cfd, readconn);
+    }
+}
+
+/* another wm, a nested one for instance, already answers on the path */
+static bool socketlive(const struct sockaddr_un *addr) {
+    int fd;
+    bool live;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) return 0;
+    live = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0 ||
+           (errno != ECONNREFUSED && errno != ENOENT);
+    close(fd);
+    return live;
+}
+
+/* the wm runs fine without the socket, failing here only costs the ipc */
+void setup_ipc() {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    const char *path = getenv("DEVOID_SOCKET"), *dir = getenv("XDG_RUNTIME_DIR");
+    char display[64], *p;
+    int n;
+
+    /* one socket per display, "host:1.0" gives devoid-host_1.0.sock */
+    snprintf(display, sizeof(display), "%s", DisplayString(dpy));
+    for (p = display; *p; p ++) if (*p == ':' || *p == '/') *p = '_';
+    p = display[0] == '_' ? display + 1 : display;
+
+    if (path) n = snprintf(sockpath, sizeof(sockpath), "%s", path);
+    else if (dir) n = snprintf(sockpath, sizeof(sockpath), "%s/devoid-%s.sock", dir, p);
+    else n = snprintf(sockpath, sizeof(sockpath), "/tmp/devoid-%u-%s.sock",
+                      (unsigned)getuid(), p);
+    if (n < 0 || (size_t)n >= sizeof(sockpath)) {
+        fprintf(stderr, "devoidwm: socket path too long, ipc disabled\n");
+        return;
+    }
+    memcpy(addr.sun_path, sockpath, n + 1);
+
+    /* only a socket nobody listens on is stale and safe to replace */
+    if (socketlive(&addr)) {
+        fprintf(stderr, "devoidwm: %s is in use, ipc disabled\n", sockpath);
+        return;
+    }
+    unlink(sockpath);
+    if ((sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ||
+        bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        chmod(sockpath, 0600) < 0 || listen(sockfd, 8) < 0) {
+        fprintf(stderr, "devoidwm: failed to open %s, ipc disabled\n", sockpath);
+        if (sockfd >= 0) close(sockfd);
+        sockfd = -1;
+        return;
+    }
+    watchfd(sockfd, acceptconn);
+}
+
+/* queues a discrete event for the end of the batch, an event that undoes
+ * one still pending cancels it instead */
+static void notify(unsigned int type, Window win, bool on) {
+    if (!(subscribed & type)) return;
+
+    for (unsigned int i = 0; i < npending; i ++)
+        if (pending[i].type == type && pending[i].win == win && pending[i].on != on) {
+            memmove(&pending[i], &pending[i + 1], (-- npending - i) * sizeof(Pending));
+            return;
+        }
+
+    if (npending == pendingsize) {
+        pendingsize = pendingsize ? pendingsize * 2 : 16;
+        if (!(pending = (Pending *)realloc(pending, pendingsize * sizeof(Pending))))
+            die("memory allocation failed");
+    }
+    pending[npending ++] = (Pending){type, win, on};
+}
+
+void notify_window(Window win, bool mapped) {
+    notify(EvWindow, win, mapped);
+}
+
+void notify_fullscreen(Window win, bool on) {
+    notify(EvFullscreen, win, on);
+}
+
+static void writeevents(FILE *out, unsigned int events) {
+    Client *c;
+
+    if (events & EvView) fprintf(out, "{\"event\":\"view\",\"tags\":%u}\n", seltags);
+    if (events & EvLayout) {
+        fputs("{\"event\":\"layout\",\"layout\":", out);
+        putstring(out, layoutname(root.layout) ? layoutname(root.layout) : "");
+        fprintf(out, ",\"nmaster\":%u,\"mratio\":%.2f}\n", nmaster, mratio);
+    }
+
+    for (unsigned int i = 0; i < npending; i ++) {
+        if (!(events & pending[i].type)) continue;
+        if (pending[i].type == EvFullscreen)
+            fprintf(out, "{\"event\":\"fullscreen\",\"win\":%lu,\"fullscreen\":%s}\n",
+                    pending[i].win, pending[i].on ? "true" : "false");
+        else if (!pending[i].on)
+            fprintf(out, "{\"event\":\"unmap\",\"win\":%lu}\n", pending[i].win);
+        else if ((c = wintoclient(pending[i].win))) {
+            fputs("{\"event\":\"map\",\"client\":", out);
+            putclient(out, c);
+            fputs("}\n", out);
+        }
+    }
+
+    /* last, so a bar sees the window that just got mapped before its focus */
+    if (events & EvFocus) {
+        if (sel) fprintf(out, "{\"event\":\"focus\",\"win\":%lu}\n", sel -> win);
+        else fputs("{\"event\":\"focus\",\"win\":null}\n", out);
+    }
+}
+
+/* called at the end of every batch, pushes whatever changed in it to the
+ * subscribers. Costs a few compares when nobody listens */
+void publish_events() {
+    unsigned int changed = 0;
+    Window focus = sel ? sel -> win : None;
+    Conn *conn, *next;
+    FILE *out;
+    char *buf;
+    size_t len;
+
+    /* a query flushing in the middle of a batch: a failed send would free
+     * the connection being served, the events wait for the flush at the
+     * end of the loop instead */
+    if (serving) return;
+
+    if (focus != lastfocus) changed |= EvFocus;
+    if (seltags != lastview) changed |= EvView;
+    if (root.layout != lastlayout || nmaster != lastnmaster || mratio != lastmratio)
+        changed |= EvLayout;
+    lastfocus = focus;
+    lastview = seltags;
+    lastlayout = root.layout;
+    lastnmaster = nmaster;
+    lastmratio = mratio;
+
+    for (unsigned int i = 0; i < npending; i ++) changed |= pending[i].type;
+    if (!(changed & subscribed)) {
+        npending = 0;
+        return;
+    }
+
+    for (conn = conns; conn; conn = next) {
+        next = conn -> next;
+        if (!(conn -> events & changed)) continue;
+
+        if (!(out = open_memstream(&buf, &len))) die("memory allocation failed");
+        writeevents(out, conn -> events & changed);
+        fclose(out);
+        if (len && !sendreply(conn, buf, len)) closeconn(conn);
+        free(buf);
+    }
+    npending = 0;
+}
+
+void cleanup_ipc() {
+    while (conns) closeconn(conns);
+    if (sockfd < 0) return;
+
+    unwatchfd(sockfd);
+    close(sockfd);
+    unlink(sockpath);
+    sockfd = -1;
+}
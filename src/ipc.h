@@ -0,0 +1,23 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include <X11/Xlib.h>
+#include <stdbool.h>
+
+/* what a connection can subscribe to */
+enum {
+    EvFocus = 1 << 0,
+    EvView = 1 << 1,
+    EvLayout = 1 << 2,
+    EvWindow = 1 << 3,
+    EvFullscreen = 1 << 4,
+    EvAll = (1 << 5) - 1,
+};
+
+void setup_ipc();
+void cleanup_ipc();
+void notify_window(Window win, bool mapped);
+void notify_fullscreen(Window win, bool on);
+void publish_events();
+
+#endif
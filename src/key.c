@@ -1,18 +1,148 @@
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <X11/XKBlib.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "devoid.h"
 #include "key.h"
+#include "conf.h"
+#include "restart.h"
+#include "stats.h"
 #include "../config.h"
 
-void handle_keypress(XEvent *event) {
-    for (size_t i = 0; i < sizeof(keys) / sizeof(Key); i ++) {
-        KeySym keysym = XkbKeycodeToKeysym(dpy, event -> xkey.keycode, 0, 0);
-        if (keysym == keys[i].keysym &&
-            CLEANMASK(keys[i].modifier) == CLEANMASK(event -> xkey.state))
-            keys[i].execute(keys[i].arg);
+static const Action actions[] = {
+    {"quit", quit, ArgNone},
+    {"reload", reload, ArgNone},
+    {"restart", restart, ArgNone},
+    {"focus_adjacent", focus_adjacent, ArgInt},
+    {"zoom", zoom, ArgNone},
+    {"killclient", killclient, ArgNone},
+    {"togglefullscr", togglefullscr, ArgNone},
+    {"setmratio", setmratio, ArgFloat},
+    {"incmaster", incmaster, ArgInt},
+    {"view", view, ArgTag},
+    {"toggletag", toggletag, ArgTag},
+    {"tag", tag, ArgTag},
+    {"setlayout", setlayout, ArgLayout},
+};
+
+static const char *layout_names[] = {
+    [DWINDLE] = "dwindle",
+    [MIRROR_DWINDLE] = "mirror_dwindle",
+    [FLOATING] = "floating",
+};
+
+/* the active key bindings, keys[] unless a config file replaced them */
+const Key *bindings = keys;
+size_t nbindings = sizeof(keys) / sizeof(Key);
+
+/* the bindings compiled into a table indexed by keycode and modifier slot, so a
+ * keypress is a lookup instead of a keysym translation per binding */
+static const Key **keymap;
+static unsigned char maskslot[256]; /* CLEANMASK(state) -> slot, 0 is unbound */
+static unsigned int nslots;
+
+/* (re)builds the dispatch table from the current keyboard mapping and grabs
+ * every bound key, called at startup and on MappingNotify */
+void grabkeys() {
+    int min, max, per, code;
+    unsigned int i, slot;
+
+    XUngrabKey(dpy, AnyKey, AnyModifier, root.win);
+
+    /* one slot per distinct modifier combination used in the bindings */
+    for (i = 0; i < 256; i ++) maskslot[i] = 0;
+    nslots = 1;
+    for (i = 0; i < nbindings; i ++)
+        if (!maskslot[CLEANMASK(bindings[i].modifier)])
+            maskslot[CLEANMASK(bindings[i].modifier)] = nslots ++;
+
+    free(keymap);
+    if (!(keymap = (const Key **)calloc(256 * nslots, sizeof(Key *))))
+        die("memory allocation failed");
+
+    XDisplayKeycodes(dpy, &min, &max);
+    KeySym *syms = ROUNDTRIP(XGetKeyboardMapping(dpy, min, max - min + 1, &per));
+    if (!syms) return;
+
+    for (code = min; code <= max; code ++) {
+        KeySym keysym = syms[(code - min) * per];
+        if (keysym == NoSymbol) continue;
+
+        for (i = 0; i < nbindings; i ++) {
+            if (bindings[i].keysym != keysym) continue;
+            slot = maskslot[CLEANMASK(bindings[i].modifier)];
+            keymap[code * nslots + slot] = &bindings[i];
+            XGrabKey(dpy, code, bindings[i].modifier, root.win, True,
+                     GrabModeAsync, GrabModeAsync);
+        }
     }
+    XFree(syms);
+}
+
+const char* layoutname(unsigned int layout) {
+    if (layout >= sizeof(layout_names) / sizeof(*layout_names)) return NULL;
+    return layout_names[layout];
+}
+
+const Action* getaction(const char *name) {
+    for (size_t i = 0; i < sizeof(actions) / sizeof(Action); i ++)
+        if (!strcmp(actions[i].name, name)) return &actions[i];
+    return NULL;
+}
+
+/* tags are numbered from 1, 0 meaning all of them */
+bool parsearg(const Action *action, const char *str, Arg *arg) {
+    char *end;
+    long n;
+
+    arg -> i = 0;
+    if (action -> argtype == ArgNone) return !str;
+    if (!str) return 0;
+
+    switch (action -> argtype) {
+        case ArgInt:
+            n = strtol(str, &end, 10);
+            if (end == str || *end || n < INT_MIN || n > INT_MAX) return 0;
+            arg -> i = n;
+            return 1;
+
+        /* no nan or inf, min and max would not get rid of them */
+        case ArgFloat:
+            arg -> f = strtod(str, &end);
+            return end != str && !*end && isfinite(arg -> f);
+
+        case ArgTag:
+            n = strtol(str, &end, 10);
+            if (*end || n < 0 || n > TAGS) return 0;
+            arg -> ui = n ? 1 << (n - 1) : TAGMASK;
+            return 1;
+
+        case ArgLayout:
+            for (size_t i = 0; i < sizeof(layout_names) / sizeof(*layout_names); i ++)
+                if (!strcmp(layout_names[i], str)) {
+                    arg -> ui = i;
+                    return 1;
+                }
+            n = strtol(str, &end, 10);
+            if (*end || n < 0 || n >= (long)(sizeof(layout_names) / sizeof(*layout_names)))
+                return 0;
+            arg -> ui = n;
+            return 1;
+    }
+    return 0;
+}
+
+void handle_keypress(XEvent *event) {
+    unsigned int code = event -> xkey.keycode;
+    unsigned int slot = maskslot[CLEANMASK(event -> xkey.state)];
+    const Key *key;
+
+    if (slot && code < 256 && (key = keymap[code * nslots + slot]))
+        key -> execute(key -> arg);
 }
 
 void quit(Arg arg) {
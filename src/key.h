@@ -3,6 +3,8 @@
 
 #include <X11/Xlib.h>
 #include <X11/XKBlib.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #define CLEANMASK(mask) (mask & \
                          (ShiftMask|ControlMask|Mod1Mask|Mod2Mask|Mod3Mask|Mod4Mask|Mod5Mask))
@@ -20,6 +22,22 @@ typedef struct {
     Arg arg;
 } Key;
 
+extern const Key *bindings;
+extern size_t nbindings;
+
+/* actions by name, for the config file */
+enum { ArgNone, ArgInt, ArgFloat, ArgTag, ArgLayout };
+
+typedef struct {
+    const char *name;
+    void (*execute)(const Arg arg);
+    unsigned int argtype;
+} Action;
+
+void grabkeys();
+const Action* getaction(const char *name);
+const char* layoutname(unsigned int layout);
+bool parsearg(const Action *action, const char *str, Arg *arg);
 void handle_keypress(XEvent *event);
 void quit(Arg arg);
 
@@ -5,6 +5,7 @@
 #include "devoid.h"
 #include "mouse.h"
 #include "dwindle.h"
+#include "stats.h"
 #include "../config.h"
 
 XButtonEvent prev_pointer_position;
@@ -24,15 +25,15 @@ void handle_buttonpress(XEvent *event) {
     if(event -> xbutton.subwindow == None ||
         (event -> xbutton.button == 1 && event -> xbutton.button == 3)) return;
 
-    if (XGrabPointer(dpy, event -> xbutton.subwindow, True,
+    if (ROUNDTRIP(XGrabPointer(dpy, event -> xbutton.subwindow, True,
                      PointerMotionMask|ButtonReleaseMask, GrabModeAsync,
                      GrabModeAsync, None,
                      event -> xbutton.button == 1 ?
                      cursors[CurMove] : cursors[CurResize],
-                     CurrentTime) != GrabSuccess)
+                     CurrentTime)) != GrabSuccess)
         return;
 
-    XGetWindowAttributes(dpy, event -> xbutton.subwindow, &attr);
+    ROUNDTRIP(XGetWindowAttributes(dpy, event -> xbutton.subwindow, &attr));
     prev_pointer_position = event -> xbutton;
 }
 
@@ -47,7 +48,7 @@ void handle_motionnotify(XEvent *event) {
 
     if (!c -> isfloating && root.layout != FLOATING) {
         c -> isfloating = 1;
-        tile();
+        dirty |= DirtyLayout;
     }
 
     c -> x = attr.x + (isLeftClick ? dx : 0);
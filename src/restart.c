@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "devoid.h"
+#include "dwindle.h"
+#include "ewmh.h"
+#include "focus.h"
+#include "ipc.h"
+#include "restart.h"
+
+/* Restarting execs the binary again (the new one after an upgrade) with
+ * every window left mapped. What adopt() can not read back from the
+ * windows themselves goes into _DEVOID_SNAPSHOT on the root window, 32
+ * bit items:
+ *
+ *     version, seltags, pertag[(TAGS + 1) * 3], nclients,
+ *     nclients * {win, tags, flags, x, y, w, h} in client list order,
+ *     the focus stack, top first
+ *
+ * adopt() reads and deletes it in the same request as everything else,
+ * attaches the windows in their old order and the first layout pass
+ * then finds them where they already are. */
+
+#define SNAPVERSION 1
+#define SNAPHEADER (2 + (TAGS + 1) * 3 + 1)
+#define SNAPCLIENT 7
+
+enum { SnapFloating = 1 << 0, SnapFullscr = 1 << 1 };
+
+bool restarting;
+
+/* the snapshot being restored, freed by restorestack() */
+static long *snap;
+static unsigned int nsnap, nsnapclients;
+
+void restart(Arg arg) {
+    (void)arg;
+    restarting = 1;
+    isrunning = 0;
+}
+
+static void savesnapshot() {
+    unsigned int n = 0, i = 0;
+    Client *c;
+    long *data;
+
+    for (c = head; c; c = c -> next) n ++;
+    if (!(data = (long *)malloc(SNAPSIZE(n) * sizeof(long))))
+        die("memory allocation failed");
+
+    data[i ++] = SNAPVERSION;
+    data[i ++] = seltags;
+    getpertag(data + i);
+    i += (TAGS + 1) * 3;
+
+    data[i ++] = n;
+    for (c = head; c; c = c -> next) {
+        data[i ++] = c -> win;
+        data[i ++] = c -> tags;
+        data[i ++] = (c -> isfloating ? SnapFloating : 0) | (c -> isfullscr ? SnapFullscr : 0);
+        data[i ++] = c -> geom.x;
+        data[i ++] = c -> geom.y;
+        data[i ++] = c -> geom.w;
+        data[i ++] = c -> geom.h;
+    }
+    for (c = stack; c; c = c -> snext) data[i ++] = c -> win;
+
+    XChangeProperty(dpy, root.win, snapshot_atom, XA_CARDINAL, 32, PropModeReplace,
+                    (unsigned char *)data, i);
+    free(data);
+}
+
+/* what execvp() would run for name, looked up while the wm can still back
+ * out. 0 if there is nothing executable */
+static bool findexec(const char *name, char *path, size_t size) {
+    const char *dirs = getenv("PATH"), *end;
+    int n;
+
+    if (strchr(name, '/')) {
+        n = snprintf(path, size, "%s", name);
+        return n >= 0 && (size_t)n < size && !access(path, X_OK);
+    }
+    for (dirs = dirs ? dirs : "/usr/local/bin:/usr/bin:/bin"; ; dirs = end + 1) {
+        if (!(end = strchr(dirs, ':'))) end = dirs + strlen(dirs);
+        /* an empty entry is the current directory */
+        n = end == dirs ? snprintf(path, size, "%s", name)
+                        : snprintf(path, size, "%.*s/%s", (int)(end - dirs), dirs, name);
+        if (n >= 0 && (size_t)n < size && !access(path, X_OK)) return 1;
+        if (!*end) return 0;
+    }
+}
+
+/* leaves every window as it is, unlike stop(). Only returns when there is
+ * no binary to run, with the wm still running: a package upgrade may have
+ * it missing for a moment, and failing must not end the session */
+void reexec(char *argv[]) {
+    char path[PATH_MAX];
+
+    if (!findexec(argv[0], path, sizeof(path))) {
+        fprintf(stderr, "devoidwm: restart failed, %s not found or not executable\n",
+                argv[0]);
+        restarting = 0;
+        isrunning = 1;
+        return;
+    }
+
+    savesnapshot();
+    cleanup_ipc();
+    XCloseDisplay(dpy);
+
+    execv(path, argv);
+    perror("devoidwm: execv");
+    die("restart failed");
+}
+
+bool loadsnapshot(const uint32_t *data, unsigned int len) {
+    unsigned int i;
+
+    if (len < SNAPHEADER || data[0] != SNAPVERSION) return 0;
+    if (data[SNAPHEADER - 1] > (len - SNAPHEADER) / SNAPCLIENT) return 0;
+
+    free(snap);
+    if (!(snap = (long *)malloc(len * sizeof(long)))) die("memory allocation failed");
+    /* back to signed, geometry can be negative */
+    for (i = 0; i < len; i ++) snap[i] = (int32_t)data[i];
+    nsnap = len;
+    nsnapclients = data[SNAPHEADER - 1];
+
+    if (data[1] & TAGMASK) seltags = data[1] & TAGMASK;
+    setpertag(snap + 2);
+    return 1;
+}
+
+static long* snapclient(unsigned int i) {
+    return snap + SNAPHEADER + i * SNAPCLIENT;
+}
+
+/* position in the old client list, -1 for windows it did not have */
+int snapshotrank(Window win) {
+    for (unsigned int i = 0; snap && i < nsnapclients; i ++)
+        if ((Window)(uint32_t)snapclient(i)[0] == win) return i;
+    return -1;
+}
+
+/* tags, flags and (for windows parked off screen) geometry as they were,
+ * 0 if the snapshot does not know the window */
+bool restoreclient(Client *c) {
+    int rank = snapshotrank(c -> win);
+    long *s;
+
+    if (rank < 0) return 0;
+    s = snapclient(rank);
+
+    if (s[1] & TAGMASK) c -> tags = s[1] & TAGMASK;
+    c -> isfloating = s[2] & SnapFloating;
+    c -> isfullscr = s[2] & SnapFullscr;
+    if (c -> ishidden) c -> geom = (Geometry){s[3], s[4], s[5], s[6]};
+    return 1;
+}
+
+/* puts the focus stack back in its old order, top last */
+void restorestack() {
+    Client *c;
+
+    if (!snap) return;
+    for (unsigned int i = nsnap; i > SNAPHEADER + nsnapclients * SNAPCLIENT; i --)
+        if ((c = wintoclient((Window)(uint32_t)snap[i - 1]))) {
+            detachstack(c);
+            attachstack(c);
+        }
+    focus(NULL);
+
+    free(snap);
+    snap = NULL;
+    nsnap = nsnapclients = 0;
+}
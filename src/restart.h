@@ -0,0 +1,22 @@
+#ifndef RESTART_H
+#define RESTART_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client.h"
+#include "key.h"
+
+/* the longest snapshot for n windows, in 32 bit items, see restart.c */
+#define SNAPSIZE(n) (3 + (TAGS + 1) * 3 + (n) * 8)
+
+extern bool restarting;
+
+void restart(Arg arg);
+void reexec(char *argv[]);
+bool loadsnapshot(const uint32_t *data, unsigned int len);
+int snapshotrank(Window win);
+bool restoreclient(Client *c);
+void restorestack();
+
+#endif
@@ -1,23 +1,98 @@
 #include <X11/Xutil.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "rules.h"
 #include "devoid.h"
+#include "stats.h"
 #include "../config.h"
 
+/* the active rules, rules[] unless a config file replaced them */
+const Rule *ruleset = rules;
+size_t nruleset = sizeof(rules) / sizeof(Rule);
+
+/* the rules compiled into hash tables of class and instance names, each name
+ * mapping to the last rule that mentions it */
+typedef struct {
+    const char *name;
+    unsigned int rule;
+} RuleEntry;
+
+typedef struct {
+    RuleEntry *entries;
+    unsigned int size;
+} RuleTable;
+
+static RuleTable classes, instances;
+
+static unsigned int strhash(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s ++) * 16777619u;
+    return h;
+}
+
+static void rule_table_build(RuleTable *t, bool byclass) {
+    size_t i, n = 0;
+    for (i = 0; i < nruleset; i ++)
+        if (byclass ? ruleset[i].classname : ruleset[i].instance) n ++;
+
+    free(t -> entries);
+    for (t -> size = 8; t -> size < n * 2; t -> size *= 2);
+    if (!(t -> entries = (RuleEntry *)calloc(t -> size, sizeof(RuleEntry))))
+        die("memory allocation failed");
+
+    for (i = 0; i < nruleset; i ++) {
+        const char *name = byclass ? ruleset[i].classname : ruleset[i].instance;
+        if (!name) continue;
+
+        unsigned int j = strhash(name) & (t -> size - 1);
+        while (t -> entries[j].name && strcmp(t -> entries[j].name, name))
+            j = (j + 1) & (t -> size - 1);
+
+        /* later rules override earlier ones */
+        t -> entries[j].name = name;
+        t -> entries[j].rule = i;
+    }
+}
+
+static const RuleEntry* rule_table_find(RuleTable *t, const char *name) {
+    if (!t -> size) return NULL;
+
+    unsigned int j = strhash(name) & (t -> size - 1);
+    while (t -> entries[j].name) {
+        if (!strcmp(t -> entries[j].name, name)) return &t -> entries[j];
+        j = (j + 1) & (t -> size - 1);
+    }
+    return NULL;
+}
+
+/* (re)builds the tables from the active rules */
+void setup_rules() {
+    rule_table_build(&classes, 1);
+    rule_table_build(&instances, 0);
+}
+
 void apply_rules(Client *client) {
     XClassHint hints = {NULL, NULL};
-    XGetClassHint(dpy, client -> win, &hints);
-    if (hints.res_class == NULL) hints.res_class = "";
-    if (hints.res_name == NULL) hints.res_name = "";
-
-    for (size_t i = 0; i < sizeof(rules) / sizeof(Rule); i ++) {
-        if ((rules[i].classname != NULL &&
-                strcmp(rules[i].classname, hints.res_class) == 0) ||
-            (rules[i].instance != NULL &&
-                strcmp(rules[i].instance, hints.res_name) == 0)) {
-            client -> isfloating = rules[i].isfloating;
-            client -> isfullscr = rules[i].isfullscreen;
-        }
-    }
+    ROUNDTRIP(XGetClassHint(dpy, client -> win, &hints));
+
+    match_rules(client, hints.res_class, hints.res_name);
+
+    if (hints.res_class) XFree(hints.res_class);
+    if (hints.res_name) XFree(hints.res_name);
+}
+
+/* either name may be NULL, for windows without (part of) WM_CLASS */
+void match_rules(Client *client, const char *classname, const char *instance) {
+    const RuleEntry *byclass = classname ? rule_table_find(&classes, classname) : NULL;
+    const RuleEntry *byinstance = instance ? rule_table_find(&instances, instance) : NULL;
+
+    /* of the rules matching either name, the last one wins */
+    const RuleEntry *match = byclass;
+    if (!match || (byinstance && byinstance -> rule > match -> rule))
+        match = byinstance;
+    if (!match) return;
+
+    client -> isfloating = ruleset[match -> rule].isfloating;
+    client -> isfullscr = ruleset[match -> rule].isfullscreen;
 }
@@ -1,6 +1,8 @@
 #ifndef RULES_H
 #define RULES_H
 
+#include <stddef.h>
+
 #include "client.h"
 
 typedef struct Rule {
@@ -8,6 +10,11 @@ typedef struct Rule {
     bool isfloating, isfullscreen;
 } Rule;
 
+extern const Rule *ruleset;
+extern size_t nruleset;
+
+void setup_rules();
 void apply_rules(Client *client);
+void match_rules(Client *client, const char *classname, const char *instance);
 
 #endif
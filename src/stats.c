@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <X11/Xlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "client.h"
+#include "devoid.h"
+#include "stats.h"
+
+/* per handler counters, dumped to stderr on SIGUSR1 */
+typedef struct {
+    unsigned long count, requests, roundtrips;
+    double usec;
+} Stat;
+
+unsigned long roundtrips;
+
+static Stat stats[StatLast];
+
+static const char *names[StatLast] = {
+    [KeyPress] = "KeyPress",
+    [ButtonPress] = "ButtonPress",
+    [ButtonRelease] = "ButtonRelease",
+    [MotionNotify] = "MotionNotify",
+    [EnterNotify] = "EnterNotify",
+    [DestroyNotify] = "DestroyNotify",
+    [UnmapNotify] = "UnmapNotify",
+    [MapRequest] = "MapRequest",
+    [ConfigureNotify] = "ConfigureNotify",
+    [ConfigureRequest] = "ConfigureRequest",
+    [PropertyNotify] = "PropertyNotify",
+    [ClientMessage] = "ClientMessage",
+    [MappingNotify] = "MappingNotify",
+    [StatLayout] = "layout",
+    [StatFocus] = "focus",
+};
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+void stats_begin(StatMark *mark) {
+    mark -> usec = now();
+    mark -> requests = NextRequest(dpy);
+    mark -> roundtrips = roundtrips;
+}
+
+void stats_end(int slot, StatMark *mark) {
+    Stat *s = &stats[slot];
+    s -> count ++;
+    s -> usec += now() - mark -> usec;
+    s -> requests += NextRequest(dpy) - mark -> requests;
+    s -> roundtrips += roundtrips - mark -> roundtrips;
+}
+
+void dumpstats(FILE *out) {
+    unsigned int used, capacity, peak;
+
+    fprintf(out, "%-18s %10s %12s %10s %10s\n", "handler", "count", "usec",
+            "requests", "roundtrips");
+    for (int i = 0; i < StatLast; i ++) {
+        if (!stats[i].count) continue;
+        fprintf(out, "%-18s %10lu %12.0f %10lu %10lu\n",
+                names[i] ? names[i] : "unknown", stats[i].count, stats[i].usec,
+                stats[i].requests, stats[i].roundtrips);
+    }
+    poolstats(&used, &capacity, &peak);
+    fprintf(out, "client pool: %u used, %u capacity, %u peak\n", used, capacity, peak);
+    fflush(out);
+}
+
+/* the same counters as one json object keyed by handler, plus the client
+ * pool under "pool", for the ipc */
+void writestats(FILE *out) {
+    unsigned int used, capacity, peak;
+
+    poolstats(&used, &capacity, &peak);
+    fprintf(out, "{\"pool\":{\"used\":%u,\"capacity\":%u,\"peak\":%u}",
+            used, capacity, peak);
+    for (int i = 0; i < StatLast; i ++) {
+        if (!stats[i].count) continue;
+        fputc(',', out);
+
+        if (names[i]) fprintf(out, "\"%s\":", names[i]);
+        else fprintf(out, "\"event%d\":", i);
+        fprintf(out, "{\"count\":%lu,\"usec\":%.0f,\"requests\":%lu,\"roundtrips\":%lu}",
+                stats[i].count, stats[i].usec, stats[i].requests, stats[i].roundtrips);
+    }
+    fputc('}', out);
+}
@@ -0,0 +1,25 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <X11/Xlib.h>
+#include <stdio.h>
+
+/* counts a call that waits for the server's reply */
+#define ROUNDTRIP(call) (roundtrips ++, (call))
+
+/* one slot per event type, then the deferred passes of flush_pending() */
+enum { StatLayout = LASTEvent, StatFocus, StatLast };
+
+typedef struct {
+    double usec;
+    unsigned long requests, roundtrips;
+} StatMark;
+
+extern unsigned long roundtrips;
+
+void stats_begin(StatMark *mark);
+void stats_end(int slot, StatMark *mark);
+void dumpstats(FILE *out);
+void writestats(FILE *out);
+
+#endif
@@ -9,20 +9,24 @@
 
 void view(Arg arg) {
     if (arg.ui == seltags) return;
+    unsigned int prevtags = seltags;
     seltags = arg.ui;
-    showhide(head);
+    dirty |= DirtyClients;
+    switchlayout(prevtags);
+    showhide(prevtags | seltags);
     focus(NULL);
     if (getfullscrlock(seltags)) lock_fullscr(sel);
-    else tile();
-    XSync(dpy, True);
+    else dirty |= DirtyLayout;
 }
 
 void toggletag(Arg arg) {
     if (arg.ui == seltags) return;
+    unsigned int prevtags = seltags;
     seltags ^= arg.ui;
-    showhide(head);
-    tile();
-    XSync(dpy, True);
+    dirty |= DirtyClients;
+    switchlayout(prevtags);
+    showhide(arg.ui);
+    dirty |= DirtyLayout;
 }
 
 bool getfullscrlock(unsigned int tags) {
@@ -33,10 +37,9 @@ bool getfullscrlock(unsigned int tags) {
 }
 
 void tag(Arg arg) {
-    if (arg.ui == sel -> tags) return;
-    sel -> tags = arg.ui;
-    XMoveWindow(dpy, sel -> win, DW, DH);
-    if (!sel -> isfloating) tile();
+    if (!sel || arg.ui == sel -> tags) return;
+    settags(sel, arg.ui);
+    if (!isvisible(sel, 0)) hideclient(sel);
+    if (!sel -> isfloating) dirty |= DirtyLayout;
     focus(NULL);
-    XSync(dpy, True);
 }
@@ -0,0 +1,71 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+
+#include "devoid.h"
+#include "watch.h"
+
+/* Everything the main loop waits on besides the X connection: the
+ * signalfd and the IPC sockets. pfds[0] is always the X connection, the
+ * rest mirror watches[] */
+typedef struct {
+    int fd;
+    WatchFn fn;
+} Watch;
+
+static Watch *watches;
+static struct pollfd *pfds;
+static unsigned int nwatches, capacity;
+
+void watchfd(int fd, WatchFn fn) {
+    if (nwatches == capacity) {
+        capacity = capacity ? capacity * 2 : 8;
+        if (!(watches = realloc(watches, capacity * sizeof(Watch))) ||
+            !(pfds = realloc(pfds, (capacity + 1) * sizeof(struct pollfd))))
+            die("memory allocation failed");
+    }
+    watches[nwatches ++] = (Watch){fd, fn};
+}
+
+/* safe to call from inside a callback, waitfds() looks the fd up again
+ * before every call */
+void unwatchfd(int fd) {
+    for (unsigned int i = 0; i < nwatches; i ++)
+        if (watches[i].fd == fd) {
+            watches[i] = watches[-- nwatches];
+            return;
+        }
+}
+
+static Watch *findwatch(int fd) {
+    for (unsigned int i = 0; i < nwatches; i ++)
+        if (watches[i].fd == fd) return &watches[i];
+    return NULL;
+}
+
+/* blocks until the X connection or any watched fd becomes readable and runs
+ * the callbacks of the ready ones, X events are left to the caller */
+void waitfds(int xfd) {
+    unsigned int n = nwatches;
+    struct pollfd xpfd = {xfd, POLLIN, 0};
+
+    if (!pfds) {
+        if (poll(&xpfd, 1, -1) < 0 && errno != EINTR) die("poll failed");
+        return;
+    }
+
+    pfds[0] = xpfd;
+    for (unsigned int i = 0; i < n; i ++)
+        pfds[i + 1] = (struct pollfd){watches[i].fd, POLLIN, 0};
+
+    if (poll(pfds, n + 1, -1) < 0) {
+        if (errno == EINTR) return;
+        die("poll failed");
+    }
+
+    for (unsigned int i = 1; i <= n; i ++) {
+        Watch *w;
+        if (!pfds[i].revents || !(w = findwatch(pfds[i].fd))) continue;
+        w -> fn(pfds[i].fd);
+    }
+}
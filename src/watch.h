@@ -0,0 +1,11 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+/* called with the fd once poll() reports it readable (or hung up) */
+typedef void (*WatchFn)(int fd);
+
+void watchfd(int fd, WatchFn fn);
+void unwatchfd(int fd);
+void waitfds(int xfd);
+
+#endif